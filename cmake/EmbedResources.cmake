@@ -0,0 +1,112 @@
+# embed_resources(<target> FILES <file>...)
+#
+# Generates `embedded_resources.hpp` for <target>. Every file becomes a
+# NUL-terminated constexpr byte array plus a `std::string_view` named after the
+# file (`vertex.glsl` -> `resources::vertex_glsl`), so shaders load without
+# touching the file system. `resources::load("vertex.glsl")` returns the same
+# data, unless the OPENGL_LEARNING_RESOURCE_DIR environment variable names a
+# directory holding a file of that name; then that file is read instead, which
+# keeps shader edits possible without a rebuild.
+#
+# The same file doubles as the generator when run with `cmake -P`.
+
+if(CMAKE_SCRIPT_MODE_FILE)
+  set(declarations "")
+  set(table "")
+  foreach(input IN LISTS INPUTS)
+    if(input STREQUAL "")
+      continue()
+    endif()
+    get_filename_component(name "${input}" NAME)
+    string(MAKE_C_IDENTIFIER "${name}" identifier)
+    file(READ "${input}" hex HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "'\\\\x\\1'," bytes "${hex}")
+    # CMake regexes have no {n} quantifier, so spell out ten bytes per line.
+    string(REPEAT "'\\\\x[0-9a-f][0-9a-f]'," 10 line)
+    string(REGEX REPLACE "(${line})" "\\1\n    " bytes "${bytes}")
+    string(APPEND declarations
+      "inline constexpr char // NOLINT(cppcoreguidelines-avoid-c-arrays)\n"
+      "    ${identifier}_data[] = {\n    ${bytes}'\\0'};\n"
+      "inline constexpr std::string_view ${identifier}{\n"
+      "    ${identifier}_data, sizeof(${identifier}_data) - 1};\n\n")
+    string(APPEND table "      {\"${name}\", ${identifier}},\n")
+  endforeach()
+
+  file(WRITE "${OUTPUT}.tmp"
+"// Generated by cmake/EmbedResources.cmake. Do not edit.
+#pragma once
+
+#include <array>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace resources {
+
+${declarations}\
+inline constexpr std::array<std::pair<std::string_view, std::string_view>,
+                            ${COUNT}>
+    all = {{
+${table}\
+    }};
+
+// Embedded contents of `name`, or the file of that name inside
+// OPENGL_LEARNING_RESOURCE_DIR when the variable is set and the file exists.
+// Returns an empty view for unknown names.
+inline std::string_view load(std::string_view name) {
+  if (const char *dir = std::getenv(\"OPENGL_LEARNING_RESOURCE_DIR\")) {
+    std::ifstream file(std::filesystem::path(dir) / name, std::ios::binary);
+    if (file) {
+      // Overrides live for the rest of the program, like the embedded data.
+      static std::list<std::string> overrides;
+      return overrides.emplace_back(std::istreambuf_iterator<char>(file),
+                                    std::istreambuf_iterator<char>());
+    }
+  }
+  for (const auto &[entry_name, data] : all) {
+    if (entry_name == name) {
+      return data;
+    }
+  }
+  return {};
+}
+
+} // namespace resources
+")
+  file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+  file(REMOVE "${OUTPUT}.tmp")
+  return()
+endif()
+
+set(EMBED_RESOURCES_SCRIPT "${CMAKE_CURRENT_LIST_FILE}")
+
+function(embed_resources target)
+  cmake_parse_arguments(PARSE_ARGV 1 EMBED "" "" "FILES")
+
+  set(output_dir "${CMAKE_CURRENT_BINARY_DIR}/embedded")
+  set(output "${output_dir}/embedded_resources.hpp")
+  set(inputs "")
+  foreach(file IN LISTS EMBED_FILES)
+    list(APPEND inputs "${CMAKE_CURRENT_SOURCE_DIR}/${file}")
+  endforeach()
+  list(LENGTH inputs count)
+  list(JOIN inputs "$<SEMICOLON>" joined_inputs)
+
+  add_custom_command(
+    OUTPUT "${output}"
+    COMMAND ${CMAKE_COMMAND}
+      "-DINPUTS=${joined_inputs}"
+      "-DOUTPUT=${output}"
+      "-DCOUNT=${count}"
+      -P "${EMBED_RESOURCES_SCRIPT}"
+    DEPENDS ${inputs} "${EMBED_RESOURCES_SCRIPT}"
+    COMMENT "Embedding resources for ${target}"
+    VERBATIM)
+  target_sources(${target} PRIVATE "${output}")
+  target_include_directories(${target} PRIVATE "${output_dir}")
+endfunction()
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+// Shadow copy of the program, vertex array and array buffer bindings, so
+// binds that would not change anything are never sent to the driver.
+class GLState
+{
+public:
+    struct Statistics
+    {
+        std::size_t issued = 0;
+        std::size_t elided = 0;
+    };
+
+    static GLState& getInstance()
+    {
+        static GLState instance;
+        return instance;
+    }
+
+    void useProgram(GLuint program)
+    {
+        if (changed(program_, program))
+            glUseProgram(program);
+    }
+
+    void bindVertexArray(GLuint vertexArray)
+    {
+        if (changed(vertexArray_, vertexArray))
+            glBindVertexArray(vertexArray);
+    }
+
+    void bindArrayBuffer(GLuint buffer)
+    {
+        if (changed(arrayBuffer_, buffer))
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    }
+
+    // Deleted names may be reused, so forget them if they are bound.
+    void deleteProgram(GLuint program)
+    {
+        if (program != 0 && program_ == program)
+            program_ = unknown;
+    }
+
+    void deleteVertexArray(GLuint vertexArray)
+    {
+        if (vertexArray != 0 && vertexArray_ == vertexArray)
+            vertexArray_ = 0;
+    }
+
+    void deleteBuffer(GLuint buffer)
+    {
+        if (buffer != 0 && arrayBuffer_ == buffer)
+            arrayBuffer_ = 0;
+    }
+
+    void beginFrame()
+    {
+        lastFrame_ = current_;
+        current_ = {};
+        ++frames_;
+    }
+
+    const Statistics& getFrameStatistics() const { return lastFrame_; }
+    const Statistics& getTotalStatistics() const { return total_; }
+    std::size_t getFrameCount() const { return frames_; }
+
+private:
+    GLState() = default;
+
+    static constexpr GLuint unknown = ~0u;
+
+    bool changed(GLuint& binding, GLuint value)
+    {
+        if (binding == value)
+        {
+            ++current_.elided;
+            ++total_.elided;
+            return false;
+        }
+        binding = value;
+        ++current_.issued;
+        ++total_.issued;
+        return true;
+    }
+
+    GLuint program_ = unknown;
+    GLuint vertexArray_ = unknown;
+    GLuint arrayBuffer_ = unknown;
+
+    Statistics current_;
+    Statistics lastFrame_;
+    Statistics total_;
+    std::size_t frames_ = 0;
+};
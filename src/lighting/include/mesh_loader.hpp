@@ -10,6 +10,8 @@
 #include <memory>
 #include <type_traits>
 
+#include "gl_state.hpp"
+
 using MyMesh = OpenMesh::TriMesh_ArrayKernelT<>;
 
 class VertexBufferObject
@@ -21,7 +23,7 @@ public:
         n_faces_ = mesh.n_faces();
 
         glGenBuffers(1, &VBO_);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+        GLState::getInstance().bindArrayBuffer(VBO_);
 
         vertices_ = std::make_unique<float[]>(mesh.n_faces() * 3 * 6);
         size_t idx = 0;
@@ -47,7 +49,7 @@ public:
         }
 
         glBufferData(GL_ARRAY_BUFFER, mesh.n_faces() * 3 * 3 * sizeof(float), vertices_.get(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::getInstance().bindArrayBuffer(0);
     }
 
     template<std::size_t N>
@@ -73,7 +75,7 @@ public:
         }
 
         glBufferData(GL_ARRAY_BUFFER, n_faces_ * 3 * 3 * sizeof(float), vertices_.get(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::getInstance().bindArrayBuffer(0);
     }
 
     ~VertexBufferObject() noexcept {
@@ -82,6 +84,7 @@ public:
 
     void release() {
         if (VBO_) {
+            GLState::getInstance().deleteBuffer(VBO_);
             glDeleteBuffers(1, &VBO_);
             VBO_ = 0;
         }
@@ -97,12 +100,12 @@ public:
 
     void bind() const
     {
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+        GLState::getInstance().bindArrayBuffer(VBO_);
     }
 
     void unbind() const
     {
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::getInstance().bindArrayBuffer(0);
     }
 
     std::size_t n_faces() const {
@@ -123,10 +126,10 @@ public:
         VBO_(VBO)
     {
         glGenVertexArrays(1, &VAO_);
-        glBindVertexArray(VAO_);
+        GLState::getInstance().bindVertexArray(VAO_);
         VBO.bind();
         std::invoke(set);
-        glBindVertexArray(0);
+        GLState::getInstance().bindVertexArray(0);
     }
 
     ~VertexArrayObject()
@@ -139,17 +142,19 @@ public:
         if (!VAO_) {
             return;
         }
+        GLState::getInstance().deleteVertexArray(VAO_);
         glDeleteVertexArrays(1, &VAO_);
+        VAO_ = 0;
     }
 
     void bind() const
     {
-        glBindVertexArray(VAO_);
+        GLState::getInstance().bindVertexArray(VAO_);
     }
 
     void unbind() const
     {
-        glBindVertexArray(0);
+        GLState::getInstance().bindVertexArray(0);
     }
     
     void draw() const
@@ -4,11 +4,14 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+
+#include "gl_state.hpp"
 
 class Shader
 {
 public:
-    Shader(const std::string& vertexSource, const std::string& fragmentSource)
+    Shader(std::string_view vertexSource, std::string_view fragmentSource)
     {
         programID_ = CreateShader(vertexSource, fragmentSource);
     }
@@ -17,6 +20,7 @@ public:
     {
         if (programID_)
         {
+            GLState::getInstance().deleteProgram(programID_);
             glDeleteProgram(programID_);
             programID_ = 0;
         }
@@ -27,7 +31,7 @@ public:
         release();
     }
 
-    void reset(const std::string& vertexSource, const std::string& fragmentSource)
+    void reset(std::string_view vertexSource, std::string_view fragmentSource)
     {
         release();
         programID_ = CreateShader(vertexSource, fragmentSource);
@@ -35,7 +39,7 @@ public:
 
     void use()
     {
-        glUseProgram(programID_);
+        GLState::getInstance().useProgram(programID_);
     }
 
     template<class Func, class... Args>
@@ -48,11 +52,12 @@ public:
     unsigned int getProgramID() const { return programID_; }
 
 private:
-    static unsigned int CompileShader(int type, const std::string& source)
+    static unsigned int CompileShader(int type, std::string_view source)
     {
         unsigned int shader = glCreateShader(type);
-        const char* src = source.c_str();
-        glShaderSource(shader, 1, &src, nullptr);
+        const char* src = source.data();
+        const GLint length = static_cast<GLint>(source.size());
+        glShaderSource(shader, 1, &src, &length);
         glCompileShader(shader);
 
         int result;
@@ -75,7 +80,7 @@ private:
         return shader;
     }
 
-    static unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
+    static unsigned int CreateShader(std::string_view vertexShader, std::string_view fragmentShader)
     {
         unsigned int program = glCreateProgram();
         unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
@@ -5,11 +5,13 @@
 
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
+
+#include <embedded_resources.hpp>
 
 #include <camera.hpp>
 #include <mesh_loader.hpp>
+#include <gl_state.hpp>
 #include <shader.hpp>
 
 constexpr unsigned int SCR_WIDTH = 1280;
@@ -96,26 +98,10 @@ int main(void)
         return -1;
     }
 
-    std::string vertex_source, fragment_source, light_fragment_source;
-    // Load GLSL resouce
-    {
-        std::ifstream vertex_file("vertex.glsl");
-        std::ifstream fragment_file("fragment.glsl");
-        std::ifstream light_fragment_file("light_fragment.glsl");
-        if (!vertex_file || !fragment_file || !light_fragment_file) {
-            std::cerr << "vertex and fragment shader included error\n";
-            return 0;
-        }
-        std::stringstream vertex_stream;
-        std::stringstream fragment_stream;
-        std::stringstream light_fragment_stream;
-        vertex_stream << vertex_file.rdbuf();
-        fragment_stream << fragment_file.rdbuf();
-        light_fragment_stream << light_fragment_file.rdbuf();
-        vertex_source = vertex_stream.str();
-        fragment_source = fragment_stream.str();
-        light_fragment_source = light_fragment_stream.str();
-    }
+    // GLSL sources are compiled into the binary; see cmake/EmbedResources.cmake
+    std::string_view vertex_source = resources::load("vertex.glsl");
+    std::string_view fragment_source = resources::load("fragment.glsl");
+    std::string_view light_fragment_source = resources::load("light_fragment.glsl");
 
     MyMesh mesh;
     {
@@ -181,6 +167,8 @@ int main(void)
         /* Loop until the user closes the window */
         while (!glfwWindowShouldClose(window))
         {
+            GLState::getInstance().beginFrame();
+
             /* Render here */
             glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -214,9 +202,7 @@ int main(void)
                     glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(model));
                 });
 
-                light_vao.bind();
                 light_vao.draw();
-                light_vao.unbind();
             }
 
             {
@@ -234,9 +220,7 @@ int main(void)
                     glUniform3f(loc, 1.0f, 1.0f, 1.0f);
                 });
 
-                obj_vao.bind();
                 obj_vao.draw();
-                obj_vao.unbind();
             }
 
             /* Swap front and back buffers */
@@ -245,6 +229,15 @@ int main(void)
             /* Poll for and process events */
             glfwPollEvents();
         }
+
+        const GLState& state = GLState::getInstance();
+        if (state.getFrameCount() != 0)
+        {
+            const GLState::Statistics& stats = state.getTotalStatistics();
+            std::cout << "GL binds per frame: "
+                      << stats.issued / state.getFrameCount() << " issued, "
+                      << stats.elided / state.getFrameCount() << " elided\n";
+        }
     }
 
     glfwTerminate();
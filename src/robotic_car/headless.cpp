@@ -0,0 +1,298 @@
+// Runs the line-following car without a window or GL context, as fast as
+// the CPU allows, and prints its trajectory and how long the steps took.
+//
+//   robotic_car_headless [--steps N] [--dt SECONDS] [--print-every K]
+//                        [--image line.jpg] [--bench-fleet STEPS]
+//                        [--record run.log]
+//
+// The run ends after N steps or when the car stops, whichever is first.
+// Each printed step also shows how far the car's centre is from the edge of
+// the line, read from the track's distance field (negative when over it).
+// --record writes every step to a trajectory log that robotic_car --replay
+// can play back.
+// --bench-fleet instead runs fleets of 1k, 10k and 100k cars for STEPS
+// steps each with both Fleet kernels and prints car-steps per second, then
+// the parallel update of 100k cars on 1 to all hardware threads, then how
+// long a SpatialGrid over such fleets takes to rebuild and to find every
+// pair of cars in contact.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "car_simulation.hpp"
+#include "distance_field.hpp"
+#include "fleet.hpp"
+#include "spatial_grid.hpp"
+#include "trajectory_log.hpp"
+
+namespace {
+
+// `cars` cars on the default starting line, jittered by a fixed seed, so
+// every run sees the same fleet.
+Fleet makeFleet(const SummedAreaTable &track, std::size_t cars) {
+  Fleet fleet(track);
+  fleet.reserve(cars);
+  std::mt19937 random(42);
+  std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+  for (std::size_t i = 0; i < cars; ++i) {
+    fleet.add({16.5f + 0.5f * jitter(random), 1.51f,
+               20.0f + 5.0f * jitter(random)},
+              {0.1f * jitter(random), 0.0f, 1.0f});
+  }
+  return fleet;
+}
+
+// Runs `steps` steps, on `jobs` if given, and returns car-steps per second.
+double benchFleet(Fleet &fleet, std::uint64_t steps, float dt,
+                  Fleet::Kernel kernel, JobSystem *jobs = nullptr) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint64_t step = 0; step < steps; ++step) {
+    if (jobs != nullptr) {
+      fleet.update(dt, *jobs, kernel);
+    } else {
+      fleet.update(dt, kernel);
+    }
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  return seconds > 0.0 ? static_cast<double>(fleet.size() * steps) / seconds
+                       : 0.0;
+}
+
+bool sameCars(const Fleet &a, const Fleet &b) {
+  for (std::size_t car = 0; car < a.size(); ++car) {
+    CarState x = a.state(car);
+    CarState y = b.state(car);
+    if (x.position != y.position || x.direction != y.direction) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Milliseconds per call of `run`, the best of a few.
+template <typename Run> double bestMilliseconds(Run &&run) {
+  double best = std::numeric_limits<double>::infinity();
+  for (int repeat = 0; repeat < 5; ++repeat) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    best = std::min(best, std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+  }
+  return best;
+}
+
+// Cars about a car length apart: scattered at random over a square with
+// one car per contactRadius^2.
+void benchGrid(const SummedAreaTable &track, std::size_t threads) {
+  constexpr float contactRadius = 4.0f;
+  std::println("\n{:>8} {:>12} {:>16} {:>10} {:>14}", "cars", "build (ms)",
+               std::format("on {} threads", threads), "contacts",
+               "contacts (ms)");
+  JobSystem jobs(threads);
+  for (std::size_t cars : {1'000, 10'000, 100'000}) {
+    Fleet fleet(track);
+    fleet.reserve(cars);
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(
+        0.0f, std::sqrt(static_cast<float>(cars)) * contactRadius);
+    for (std::size_t i = 0; i < cars; ++i) {
+      fleet.add({coordinate(random), 1.51f, coordinate(random)},
+                {0.0f, 0.0f, 1.0f});
+    }
+    SpatialGrid grid(contactRadius);
+    double serial =
+        bestMilliseconds([&] { grid.build(fleet.xs(), fleet.zs()); });
+    double parallel =
+        bestMilliseconds([&] { grid.build(fleet.xs(), fleet.zs(), &jobs); });
+    std::size_t contacts = 0;
+    double query = bestMilliseconds([&] {
+      contacts = 0;
+      grid.forEachPair(contactRadius,
+                       [&contacts](std::uint32_t, std::uint32_t, float) {
+                         ++contacts;
+                       });
+    });
+    std::println("{:>8} {:>12.3f} {:>16.3f} {:>10} {:>14.3f}", cars, serial,
+                 parallel, contacts, query);
+  }
+}
+
+int benchFleets(const std::string &image, std::uint64_t steps, float dt) {
+  SummedAreaTable track = loadTrack(image);
+  std::println("{:>8} {:>22} {:>22}{}", "cars", "scalar (car-steps/s)",
+               "simd (car-steps/s)",
+               Fleet::hasSimd() ? "" : "  (built without AVX2)");
+  for (std::size_t cars : {1'000, 10'000, 100'000}) {
+    Fleet scalarFleet = makeFleet(track, cars);
+    Fleet simdFleet = makeFleet(track, cars);
+    double scalar = benchFleet(scalarFleet, steps, dt, Fleet::Kernel::Scalar);
+    double simd = benchFleet(simdFleet, steps, dt, Fleet::Kernel::Simd);
+    std::println("{:>8} {:>22.3e} {:>22.3e}  {:.2f}x", cars, scalar, simd,
+                 scalar > 0.0 ? simd / scalar : 0.0);
+  }
+
+  // Scaling of the parallel update, checked against the serial result.
+  constexpr std::size_t cars = 100'000;
+  Fleet serial = makeFleet(track, cars);
+  double base = benchFleet(serial, steps, dt, Fleet::Kernel::Simd);
+  std::println("\n{:>8} {:>22} {:>9} {:>10}", "threads", "simd (car-steps/s)",
+               "speedup", "matches");
+  std::size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::size_t> threadCounts;
+  for (std::size_t threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+  for (std::size_t threads : threadCounts) {
+    JobSystem jobs(threads);
+    Fleet fleet = makeFleet(track, cars);
+    double rate = benchFleet(fleet, steps, dt, Fleet::Kernel::Simd, &jobs);
+    std::println("{:>8} {:>22.3e} {:>8.2f}x {:>10}", threads, rate,
+                 base > 0.0 ? rate / base : 0.0,
+                 sameCars(fleet, serial) ? "serial" : "DIFFERS");
+  }
+
+  benchGrid(track, maxThreads);
+  return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::uint64_t steps = 1'000'000;
+  float dt = 1.0f / 120.0f;
+  std::uint64_t printEvery = 0;
+  std::string image = "line.jpg";
+  std::uint64_t fleetSteps = 0;
+  std::string recordPath;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string_view option = argv[i];
+    std::string value = argv[i + 1];
+    if (option == "--steps") {
+      steps = std::stoull(value);
+    } else if (option == "--dt") {
+      dt = std::stof(value);
+    } else if (option == "--print-every") {
+      printEvery = std::stoull(value);
+    } else if (option == "--image") {
+      image = value;
+    } else if (option == "--bench-fleet") {
+      fleetSteps = std::stoull(value);
+    } else if (option == "--record") {
+      recordPath = value;
+    } else {
+      std::cerr << "Unknown option " << option << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+  if (printEvery == 0) {
+    printEvery = std::max<std::uint64_t>(steps / 20, 1);
+  }
+
+  try {
+    if (fleetSteps > 0) {
+      return benchFleets(image, fleetSteps, dt);
+    }
+    RoboticCar car(image);
+    car.setPosition({16.5f, 1.51f, 20.0f});
+    car.setDirection({0.0f, 0.0f, 0.5f});
+
+    auto loadStart = std::chrono::steady_clock::now();
+    DistanceField field = [&image] {
+      JobSystem jobs;
+      return DistanceField::load(image, &jobs);
+    }();
+    std::println("distance field: {} in {:.1f} ms",
+                 field.isMapped() ? "mapped from " +
+                                        DistanceField::cachePath(image)
+                                  : std::string("built"),
+                 std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - loadStart)
+                     .count());
+
+    std::println("{:>12} {:>10} {:>10} {:>10} {:>9} {:>9}", "step",
+                 "time (s)", "x", "z", "heading", "to line");
+    auto print = [&car, &field, dt](std::uint64_t step) {
+      CarState state = car.state();
+      float heading = glm::degrees(
+          std::atan2(state.direction.x, state.direction.z));
+      float toLine = field
+                         .sample(state.position.x * RoboticCar::pixelsPerUnit,
+                                 state.position.z * RoboticCar::pixelsPerUnit)
+                         .distance /
+                     RoboticCar::pixelsPerUnit;
+      std::println("{:>12} {:>10.2f} {:>10.3f} {:>10.3f} {:>9.2f} {:>9.3f}",
+                   step, static_cast<double>(step) * dt, state.position.x,
+                   state.position.z, heading, toLine);
+    };
+    print(0);
+
+    std::optional<TrajectoryRecorder> recorder;
+    if (!recordPath.empty()) {
+      recorder.emplace(recordPath, dt);
+    }
+
+    std::chrono::steady_clock::duration elapsed{};
+    std::uint64_t step = 0;
+    while (step < steps && !car.isStopped()) {
+      std::uint64_t batch = std::min(printEvery - step % printEvery,
+                                     steps - step);
+      auto start = std::chrono::steady_clock::now();
+      for (std::uint64_t i = 0; i < batch && !car.isStopped(); ++i) {
+        car.update(dt);
+        if (recorder) {
+          recorder->record(TrajectoryStep::of(car));
+        }
+        ++step;
+      }
+      elapsed += std::chrono::steady_clock::now() - start;
+      print(step);
+    }
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::println("{} steps ({:.1f} s simulated) in {:.3f} s: {:.2f} million "
+                 "steps per second, {:.0f}x real time{}",
+                 step, static_cast<double>(step) * dt, seconds,
+                 seconds > 0.0 ? static_cast<double>(step) / seconds / 1e6
+                               : 0.0,
+                 seconds > 0.0 ? static_cast<double>(step) * dt / seconds
+                               : 0.0,
+                 car.isStopped() ? "; the car stopped" : "");
+    std::println("sensor cache: {:.1f}% of {} reads answered without the "
+                 "track",
+                 100.0 * car.sensorCacheStatistics().hitRate(),
+                 car.sensorCacheStatistics().reads);
+    if (recorder) {
+      recorder->close();
+      std::println("recorded {} steps in {} bytes ({:.2f} per step) to {}",
+                   recorder->stepsWritten(), recorder->bytesWritten(),
+                   step > 0 ? static_cast<double>(recorder->bytesWritten()) /
+                                  static_cast<double>(step)
+                            : 0.0,
+                   recordPath);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+
+#include <glm/glm.hpp>
+
+struct AABB {
+  glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+  glm::vec3 center() const { return (min + max) * 0.5f; }
+  glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+  void expand(const glm::vec3 &point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+
+  // Box around the transformed box (Arvo's method), without transforming
+  // all eight corners.
+  AABB transformed(const glm::mat4 &matrix) const {
+    glm::vec3 translation(matrix[3]);
+    AABB result = {.min = translation, .max = translation};
+    for (int column = 0; column < 3; ++column) {
+      for (int row = 0; row < 3; ++row) {
+        float a = matrix[column][row] * min[column];
+        float b = matrix[column][row] * max[column];
+        result.min[row] += std::min(a, b);
+        result.max[row] += std::max(a, b);
+      }
+    }
+    return result;
+  }
+};
+
+struct BoundingSphere {
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = 0.0f;
+
+  // Conservative under non-uniform scale: the radius grows by the largest
+  // axis scale.
+  BoundingSphere transformed(const glm::mat4 &matrix) const {
+    float scale = std::sqrt(std::max({glm::dot(matrix[0], matrix[0]),
+                                      glm::dot(matrix[1], matrix[1]),
+                                      glm::dot(matrix[2], matrix[2])}));
+    return {.center = glm::vec3(matrix * glm::vec4(center, 1.0f)),
+            .radius = radius * scale};
+  }
+};
+
+// Both kinds of bounds, computed once when a mesh is loaded.
+struct Bounds {
+  AABB box;
+  BoundingSphere sphere;
+
+  // `positions` holds x, y, z for each vertex. The sphere is centred on the
+  // box, which is not minimal but cheap and good enough for culling.
+  static Bounds fromPositions(std::span<const float> positions) {
+    Bounds bounds;
+    for (std::size_t i = 0; i + 2 < positions.size(); i += 3) {
+      bounds.box.expand({positions[i], positions[i + 1], positions[i + 2]});
+    }
+    if (positions.size() < 3) {
+      bounds.box = {.min = glm::vec3(0.0f), .max = glm::vec3(0.0f)};
+    }
+    bounds.sphere.center = bounds.box.center();
+    float radius2 = 0.0f;
+    for (std::size_t i = 0; i + 2 < positions.size(); i += 3) {
+      glm::vec3 offset =
+          glm::vec3(positions[i], positions[i + 1], positions[i + 2]) -
+          bounds.sphere.center;
+      radius2 = std::max(radius2, glm::dot(offset, offset));
+    }
+    bounds.sphere.radius = std::sqrt(radius2);
+    return bounds;
+  }
+};
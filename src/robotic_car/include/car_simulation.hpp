@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "summed_area_table.hpp"
+#include "track_image.hpp"
+
+// The line-following car without any rendering. It only needs the decoded
+// track image, so it runs without GL, a window or GLFW; CarModel draws it.
+
+enum class CarColor : std::uint8_t { Yellow, Green, Blue };
+
+struct CarSensor {
+  glm::vec3 relative_position;
+  CarColor color;
+  float scale;
+};
+
+// Loads a track image into the integral image the sensors sample. The
+// decoded pixels are freed once the table is built.
+inline SummedAreaTable loadTrack(std::string_view path) {
+  TrackImage image = loadTrackImage(path);
+  return {image.pixels.get(), image.width, image.height, image.channels};
+}
+
+// What the renderer needs of a car, copied out of the simulation so the two
+// can run on different threads.
+struct CarState {
+  glm::vec3 position = glm::vec3(0.0f);
+  glm::vec3 direction = {0.0f, 0.0f, 1.0f};
+  std::array<CarSensor, 6> sensors{};
+
+  // Position and heading blended by `t` in [0, 1]. Sensor colours are not
+  // blended; they come from whichever state is nearer.
+  static CarState interpolate(const CarState &a, const CarState &b, float t) {
+    glm::vec3 direction = glm::mix(a.direction, b.direction, t);
+    float length = glm::length(direction);
+    return {.position = glm::mix(a.position, b.position, t),
+            .direction = length > 1e-6f ? direction / length : b.direction,
+            .sensors = t < 0.5f ? a.sensors : b.sensors};
+  }
+};
+
+// What the car does next, given which of its six sensors see the line.
+enum class CarAction : std::uint8_t { Forward, TurnLeft, TurnRight, Stop };
+
+struct CarDecision {
+  CarAction action = CarAction::Forward;
+  // Keep the action for a while instead of deciding again next step.
+  bool hold = false;
+};
+
+// The steering rules. Bit i of `black` is set when sensor i + 1 sees black;
+// later rules override earlier ones. A pure function of six bits, so it can
+// also be tabulated (see Fleet).
+constexpr CarDecision decideAction(unsigned black) {
+  auto sees = [black](int sensor) {
+    return ((black >> (sensor - 1)) & 1u) != 0;
+  };
+  using enum CarAction;
+  black &= 0x3fu;
+  CarDecision decision;
+  if (sees(3) || sees(6)) {
+    decision.action = TurnRight;
+  }
+  if (sees(1) || sees(4)) {
+    decision.action = TurnLeft;
+  }
+  if (black == 0x3fu) {
+    decision.action = Stop;
+  }
+  if (black == 0x3du) { // every sensor but the front one
+    decision = {.action = Forward, .hold = true};
+  }
+  return decision;
+}
+
+class RoboticCar {
+public:
+  // Track image pixels per world unit, and the side of the square each
+  // sensor averages over, in pixels.
+  static constexpr float pixelsPerUnit = 10.0f;
+  static constexpr std::ptrdiff_t sensorFootprint = 10;
+  // Steering angle per step, and how long a held decision lasts.
+  static constexpr float turnDegrees = 1.0f / 5.0f;
+  static constexpr float holdSeconds = 0.25f;
+  static constexpr float speed = 10.0f;
+
+  // Where the six sensors sit relative to the car, in the order
+  // decideAction() numbers them.
+  static std::array<CarSensor, 6> defaultSensors() {
+    auto sensor = [](float x, float z) {
+      return CarSensor{.relative_position = glm::vec3(x, 0.0f, z),
+                       .color = CarColor::Blue,
+                       .scale = 0.1f};
+    };
+    return {sensor(-2.5f, 2.0f), sensor(0.0f, 4.0f), sensor(2.5f, 2.0f),
+            sensor(-1.5f, 2.0f), sensor(0.0f, 2.0f), sensor(1.5f, 2.0f)};
+  }
+
+  // What a controller can be tuned by without recompiling; the defaults
+  // are the constants above.
+  struct Parameters {
+    float speed = RoboticCar::speed;
+    float turnDegrees = RoboticCar::turnDegrees;
+    float holdSeconds = RoboticCar::holdSeconds;
+    std::array<CarSensor, 6> sensors = defaultSensors();
+  };
+
+  explicit RoboticCar(std::string_view line_image_path)
+      : RoboticCar(std::make_shared<const SummedAreaTable>(
+                       loadTrack(line_image_path)),
+                   Parameters{}) {}
+
+  // A car on a track that is already loaded, which many cars can share.
+  RoboticCar(std::shared_ptr<const SummedAreaTable> track,
+             const Parameters &parameters)
+      : track_(std::move(track)), parameters_(parameters),
+        position_({0.0f, 1.5f, 0.0f}), direction_({0.0f, 0.0f, 1.0f}),
+        velocity_(parameters.speed), sensors_(parameters.sensors) {}
+
+  ~RoboticCar() = default;
+  RoboticCar(const RoboticCar &) = delete;
+  RoboticCar &operator=(const RoboticCar &) = delete;
+  RoboticCar(RoboticCar &&) = delete;
+  RoboticCar &operator=(RoboticCar &&) = delete;
+
+  void setPosition(const glm::vec3 &position) { position_ = position; }
+
+  void setDirection(const glm::vec3 &direction) {
+    direction_ = glm::normalize(direction);
+  }
+
+  // Advances the car by `deltaTime` seconds. Steering turns a fixed angle
+  // per call, so call it with a fixed step (see Simulation) for the car to
+  // behave the same at any frame rate.
+  void update(float deltaTime) {
+    holdTime_ = std::max(0.0f, holdTime_ - deltaTime);
+    sense();
+    algorithm(black_);
+    position_ += velocity_ * deltaTime * direction_;
+  }
+
+  // True once the car has seen the stop pattern; it never moves again.
+  bool isStopped() const { return velocity_ == 0.0f; }
+
+  // Bit i set: sensor i + 1 saw black in the last update.
+  unsigned sensorBits() const { return black_; }
+  // What the last update did; Forward while a decision is held.
+  CarAction action() const { return action_; }
+
+  // How many sensor reads were answered without touching the track.
+  struct SensorCacheStatistics {
+    std::uint64_t reads = 0;
+    std::uint64_t hits = 0;
+
+    double hitRate() const {
+      return reads == 0 ? 0.0
+                        : static_cast<double>(hits) /
+                              static_cast<double>(reads);
+    }
+  };
+
+  const SensorCacheStatistics &sensorCacheStatistics() const {
+    return cacheStatistics_;
+  }
+
+  CarState state() const {
+    return {.position = position_, .direction = direction_,
+            .sensors = sensors_};
+  }
+
+private:
+  std::shared_ptr<const SummedAreaTable> track_;
+  Parameters parameters_;
+  glm::vec3 position_;
+  glm::vec3 direction_;
+  float velocity_;
+  // Simulated seconds for which the last decision is kept.
+  float holdTime_ = 0.0f;
+  CarAction action_ = CarAction::Forward;
+  std::array<CarSensor, 6> sensors_;
+
+  // What each sensor last read, keyed by the pixel its footprint was
+  // centred on. The footprint is a whole-pixel box, so the same pixel
+  // always reads the same.
+  struct SensorReading {
+    std::ptrdiff_t row = std::numeric_limits<std::ptrdiff_t>::min();
+    std::ptrdiff_t column = std::numeric_limits<std::ptrdiff_t>::min();
+  };
+  std::array<SensorReading, 6> readings_{};
+  glm::vec3 sensedPosition_ = glm::vec3(0.0f);
+  glm::vec3 sensedDirection_ = glm::vec3(0.0f);
+  unsigned black_ = 0; // bit i set: sensor i + 1 sees black
+  SensorCacheStatistics cacheStatistics_;
+
+  // Reads the sensors that may have changed. A car that has neither moved
+  // nor turned since the last call, such as a stopped one, reads nothing.
+  // One that moved less than half a pixel rereads only the sensors that
+  // crossed into another pixel. Faster cars move most sensors every step,
+  // and a read is only four lookups, so they reread all six rather than
+  // pay for the check.
+  void sense() {
+    cacheStatistics_.reads += sensors_.size();
+    glm::vec3 moved = position_ - sensedPosition_;
+    if (moved == glm::vec3(0.0f) && direction_ == sensedDirection_) {
+      cacheStatistics_.hits += sensors_.size();
+      return;
+    }
+    constexpr float slowPixels = 0.5f;
+    bool slow = glm::dot(moved, moved) * pixelsPerUnit * pixelsPerUnit <
+                slowPixels * slowPixels;
+    sensedPosition_ = position_;
+    sensedDirection_ = direction_;
+
+    for (std::size_t i = 0; i < sensors_.size(); ++i) {
+      // The sensor's offset turned to the car's heading; direction_ is a
+      // unit vector in the xz plane, so no trigonometry is needed.
+      const glm::vec3 &offset = sensors_[i].relative_position;
+      auto row = static_cast<std::ptrdiff_t>(
+          (position_.z +
+           (offset.z * direction_.z - offset.x * direction_.x)) *
+          pixelsPerUnit);
+      auto column = static_cast<std::ptrdiff_t>(
+          (position_.x +
+           (offset.x * direction_.z + offset.z * direction_.x)) *
+          pixelsPerUnit);
+      SensorReading &reading = readings_[i];
+      if (slow && row == reading.row && column == reading.column) {
+        ++cacheStatistics_.hits;
+        continue;
+      }
+      reading = {.row = row, .column = column};
+      // The mean of the track under the sensor's footprint: four lookups
+      // whatever the footprint. Pixels off the image count as black.
+      bool white = track_->average(row, column, sensorFootprint) > 128.0;
+      sensors_[i].color = white ? CarColor::Green : CarColor::Blue;
+      black_ = (black_ & ~(1u << i)) | (white ? 0u : 1u << i);
+    }
+  }
+
+  void algorithm(unsigned black) {
+    using enum CarAction;
+    CarDecision decision;
+    if (holdTime_ <= 0.0f) {
+      decision = decideAction(black);
+      if (decision.hold) {
+        holdTime_ = parameters_.holdSeconds;
+      }
+    }
+
+    action_ = decision.action;
+    switch (decision.action) {
+    case Forward:
+      break;
+    case TurnLeft:
+      turn(-parameters_.turnDegrees);
+      break;
+    case TurnRight:
+      turn(parameters_.turnDegrees);
+      break;
+    case Stop:
+      velocity_ = 0.0f;
+      break;
+    default:
+      break;
+    }
+  }
+
+  void turn(float degrees) {
+    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(degrees),
+                                     glm::vec3(0.0f, 1.0f, 0.0f));
+    direction_ =
+        glm::normalize(glm::vec3(rotation * glm::vec4(direction_, 1.0f)));
+  }
+};
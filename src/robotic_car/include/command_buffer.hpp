@@ -0,0 +1,202 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "geometry_arena.hpp"
+#include "gl_state.hpp"
+#include "instance_buffer.hpp"
+#include "thread_pool.hpp"
+
+// A list of GL work recorded on any thread and replayed later on the GL
+// thread. Recording makes no GL calls: each command is an opcode followed
+// by its arguments, copied into one growing byte buffer, so a buffer that is
+// cleared and reused every frame stops allocating after the first few
+// frames. Uniforms are recorded by location, so look locations up on the GL
+// thread beforehand.
+class CommandBuffer {
+public:
+  void useProgram(GLuint program) { write(Op::UseProgram, program); }
+
+  void bindTexture(GLuint unit, GLuint texture) {
+    write(Op::BindTexture, TextureBinding{.unit = unit, .texture = texture});
+  }
+
+  void uniform(GLint location, const glm::mat4 &value) {
+    write(Op::UniformMatrix4, Uniform<glm::mat4>{location, value});
+  }
+
+  void uniform(GLint location, const glm::vec4 &value) {
+    write(Op::Uniform4, Uniform<glm::vec4>{location, value});
+  }
+
+  // Copies `instances`; on replay they are uploaded to `buffer` and drawn as
+  // one instanced draw of `mesh`.
+  void drawInstances(GeometryArena &geometry, GeometryArena::Handle mesh,
+                     InstanceBuffer &buffer,
+                     std::span<const InstanceData> instances) {
+    if (instances.empty()) {
+      return;
+    }
+    write(Op::DrawInstances,
+          Draw{.geometry = &geometry,
+               .buffer = &buffer,
+               .mesh = mesh,
+               .count = static_cast<std::uint32_t>(instances.size())});
+    append(std::as_bytes(instances));
+  }
+
+  // Adds to GLState's object counters, which are not thread safe.
+  void countObjects(std::size_t drawn, std::size_t culled) {
+    write(Op::CountObjects, Objects{.drawn = drawn, .culled = culled});
+  }
+
+  // GL thread only.
+  void replay() const {
+    GLState &state = GLState::getInstance();
+    std::size_t position = 0;
+    while (position < bytes_.size()) {
+      switch (read<Op>(position)) {
+      case Op::UseProgram:
+        state.useProgram(read<GLuint>(position));
+        break;
+      case Op::BindTexture: {
+        auto binding = read<TextureBinding>(position);
+        state.bindTextureUnit(binding.unit, binding.texture);
+        break;
+      }
+      case Op::UniformMatrix4: {
+        auto uniform = read<Uniform<glm::mat4>>(position);
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE,
+                           glm::value_ptr(uniform.value));
+        break;
+      }
+      case Op::Uniform4: {
+        auto uniform = read<Uniform<glm::vec4>>(position);
+        glUniform4fv(uniform.location, 1, glm::value_ptr(uniform.value));
+        break;
+      }
+      case Op::DrawInstances: {
+        auto draw = read<Draw>(position);
+        std::size_t size = draw.count * sizeof(InstanceData);
+        draw.buffer->upload(std::span(bytes_).subspan(position, size));
+        position += size;
+        draw.geometry->draw(draw.mesh, draw.count);
+        draw.geometry->submit(draw.buffer);
+        break;
+      }
+      case Op::CountObjects: {
+        auto objects = read<Objects>(position);
+        state.countObjects(objects.drawn, objects.culled);
+        break;
+      }
+      }
+    }
+  }
+
+  // Keeps the storage for the next frame.
+  void clear() { bytes_.clear(); }
+  bool empty() const { return bytes_.empty(); }
+  std::size_t size() const { return bytes_.size(); }
+
+private:
+  enum class Op : std::uint8_t {
+    UseProgram,
+    BindTexture,
+    UniformMatrix4,
+    Uniform4,
+    DrawInstances,
+    CountObjects
+  };
+
+  struct TextureBinding {
+    GLuint unit;
+    GLuint texture;
+  };
+
+  template <typename T> struct Uniform {
+    GLint location;
+    T value;
+  };
+
+  struct Draw {
+    GeometryArena *geometry;
+    InstanceBuffer *buffer;
+    GeometryArena::Handle mesh;
+    std::uint32_t count;
+  };
+
+  struct Objects {
+    std::size_t drawn;
+    std::size_t culled;
+  };
+
+  template <typename T> void write(Op op, const T &arguments) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    append(std::as_bytes(std::span(&op, 1)));
+    append(std::as_bytes(std::span(&arguments, 1)));
+  }
+
+  void append(std::span<const std::byte> bytes) {
+    bytes_.insert(bytes_.end(), bytes.begin(), bytes.end());
+  }
+
+  // Commands are packed without padding, so arguments are copied out rather
+  // than read in place.
+  template <typename T> T read(std::size_t &position) const {
+    T value;
+    std::memcpy(&value, bytes_.data() + position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+
+  std::vector<std::byte> bytes_;
+};
+
+// Records a frame's draws on every thread of a ThreadPool, one CommandBuffer
+// per chunk of the work, and replays the buffers in chunk order. Chunks are
+// fixed by the item count, not by which thread ran them, so the GL calls come
+// out in the same order however the chunks were scheduled.
+class ParallelRecorder {
+public:
+  // `chunksPerThread` above one lets fast threads pick up the slack of slow
+  // ones.
+  explicit ParallelRecorder(ThreadPool &pool, std::size_t chunksPerThread = 4)
+      : pool_(pool), buffers_(pool.size() * chunksPerThread) {}
+
+  // Calls `record(CommandBuffer &, std::size_t begin, std::size_t end)` for
+  // consecutive ranges covering [0, count), in parallel.
+  template <typename Record> void record(std::size_t count, Record &&record) {
+    for (CommandBuffer &buffer : buffers_) {
+      buffer.clear();
+    }
+    std::size_t chunks = std::min(buffers_.size(), count);
+    pool_.parallelFor(chunks, [&](std::size_t chunk) {
+      record(buffers_[chunk], count * chunk / chunks,
+             count * (chunk + 1) / chunks);
+    });
+  }
+
+  // GL thread only.
+  void replay() const {
+    for (const CommandBuffer &buffer : buffers_) {
+      buffer.replay();
+    }
+  }
+
+  std::size_t threadCount() const { return pool_.size(); }
+
+private:
+  ThreadPool &pool_;
+  std::vector<CommandBuffer> buffers_;
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <print>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "gl_capabilities.hpp"
+#include "mpsc_ring.hpp"
+
+// Collects KHR_debug messages. The driver callback only copies the message
+// and the current debug group path into a lock-free ring; the GL thread
+// drains it once per frame, deduplicates by message ID and prints each
+// distinct message the first time it is seen. Performance warnings (implicit
+// syncs, buffer respecification, shader recompiles) can then be traced back
+// to the DebugGroup they were raised in.
+class DebugOutput {
+public:
+  struct Summary {
+    GLenum source;
+    GLenum type;
+    GLenum severity;
+    GLuint id;
+    std::string text;
+    std::string group;
+    std::size_t count;
+  };
+
+  ~DebugOutput() = default;
+  DebugOutput(const DebugOutput &) = delete;
+  DebugOutput &operator=(const DebugOutput &) = delete;
+  DebugOutput(DebugOutput &&) = delete;
+  DebugOutput &operator=(DebugOutput &&) = delete;
+
+  static DebugOutput &getInstance() {
+    static DebugOutput instance;
+    return instance;
+  }
+
+  // Requires a current context created with a debug flag for most drivers
+  // to report anything useful.
+  void install() {
+    if (!GLCapabilities::getInstance().hasDebugOutput()) {
+      return;
+    }
+    glEnable(GL_DEBUG_OUTPUT);
+    // Messages must arrive on the GL thread while the group is still pushed.
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(&DebugOutput::callback, this);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0,
+                          nullptr, GL_TRUE);
+    // Our own group markers would otherwise be reported back to us.
+    glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PUSH_GROUP,
+                          GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_POP_GROUP,
+                          GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    enabled_ = true;
+  }
+
+  bool isEnabled() const { return enabled_; }
+
+  void pushGroup(std::string_view label) {
+    if (!enabled_) {
+      return;
+    }
+    groupLengths_.push_back(groupPathLength_);
+    std::size_t length = groupPathLength_;
+    if (length != 0 && length < groupPath_.size() - 1) {
+      groupPath_[length++] = '/';
+    }
+    std::size_t copied =
+        std::min(label.size(), groupPath_.size() - 1 - length);
+    std::copy_n(label.data(), copied, groupPath_.begin() + length);
+    groupPathLength_ = length + copied;
+    groupPath_[groupPathLength_] = '\0';
+
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0,
+                     static_cast<GLsizei>(label.size()), label.data());
+  }
+
+  void popGroup() {
+    if (!enabled_ || groupLengths_.empty()) {
+      return;
+    }
+    glPopDebugGroup();
+    groupPathLength_ = groupLengths_.back();
+    groupLengths_.pop_back();
+    groupPath_[groupPathLength_] = '\0';
+  }
+
+  // Moves queued messages into the per-ID summaries and prints the first
+  // occurrence of each. Call from the GL thread.
+  void drain() {
+    while (messages_.tryPop([this](const Message &message) {
+      std::uint64_t key = keyOf(message.source, message.type, message.id);
+      auto [iter, inserted] = summaries_.try_emplace(
+          key, Summary{.source = message.source,
+                       .type = message.type,
+                       .severity = message.severity,
+                       .id = message.id,
+                       .text = message.text.data(),
+                       .group = message.group.data(),
+                       .count = 0});
+      ++iter->second.count;
+      if (inserted) {
+        printSummary(stderr, iter->second);
+      }
+    })) {
+    }
+  }
+
+  // Prints every distinct message with its count, most frequent first.
+  void report(std::FILE *stream) {
+    drain();
+    std::vector<const Summary *> sorted;
+    sorted.reserve(summaries_.size());
+    for (const auto &[key, summary] : summaries_) {
+      sorted.push_back(&summary);
+    }
+    std::ranges::sort(sorted, [](const Summary *a, const Summary *b) {
+      return a->count > b->count;
+    });
+    for (const Summary *summary : sorted) {
+      std::print(stream, "{:>8}x ", summary->count);
+      printSummary(stream, *summary);
+    }
+    if (std::size_t dropped = dropped_.load(std::memory_order_relaxed)) {
+      std::println(stream, "GL debug: {} messages dropped (queue full)",
+                   dropped);
+    }
+  }
+
+  const std::unordered_map<std::uint64_t, Summary> &getSummaries() const {
+    return summaries_;
+  }
+
+private:
+  DebugOutput() = default;
+
+  struct Message {
+    GLenum source;
+    GLenum type;
+    GLenum severity;
+    GLuint id;
+    std::array<char, 512> text;
+    std::array<char, 128> group;
+  };
+
+  static std::uint64_t keyOf(GLenum source, GLenum type, GLuint id) {
+    return (static_cast<std::uint64_t>(source & 0xffffu) << 48) |
+           (static_cast<std::uint64_t>(type & 0xffffu) << 32) | id;
+  }
+
+  static void GLAPIENTRY callback(GLenum source, GLenum type, GLuint id,
+                                  GLenum severity, GLsizei length,
+                                  const GLchar *text, const void *user) {
+    auto *self = static_cast<DebugOutput *>(const_cast<void *>(user));
+    bool pushed = self->messages_.tryPush([&](Message &message) {
+      message.source = source;
+      message.type = type;
+      message.severity = severity;
+      message.id = id;
+      auto size = static_cast<std::size_t>(
+          length < 0 ? std::char_traits<char>::length(text) : length);
+      size = std::min(size, message.text.size() - 1);
+      std::copy_n(text, size, message.text.begin());
+      message.text[size] = '\0';
+      std::copy_n(self->groupPath_.begin(), self->groupPathLength_ + 1,
+                  message.group.begin());
+    });
+    if (!pushed) {
+      self->dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  static void printSummary(std::FILE *stream, const Summary &summary) {
+    std::println(stream, "GL debug [{}] {} {} #{} in '{}': {}",
+                 severityName(summary.severity), sourceName(summary.source),
+                 typeName(summary.type), summary.id,
+                 summary.group.empty() ? "-" : summary.group, summary.text);
+  }
+
+  static std::string_view severityName(GLenum severity) {
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH:
+      return "high";
+    case GL_DEBUG_SEVERITY_MEDIUM:
+      return "medium";
+    case GL_DEBUG_SEVERITY_LOW:
+      return "low";
+    default:
+      return "info";
+    }
+  }
+
+  static std::string_view sourceName(GLenum source) {
+    switch (source) {
+    case GL_DEBUG_SOURCE_API:
+      return "api";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+      return "window-system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER:
+      return "shader-compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:
+      return "third-party";
+    case GL_DEBUG_SOURCE_APPLICATION:
+      return "application";
+    default:
+      return "other";
+    }
+  }
+
+  static std::string_view typeName(GLenum type) {
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR:
+      return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+      return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+      return "undefined";
+    case GL_DEBUG_TYPE_PORTABILITY:
+      return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:
+      return "performance";
+    case GL_DEBUG_TYPE_MARKER:
+      return "marker";
+    default:
+      return "other";
+    }
+  }
+
+  bool enabled_ = false;
+  MpscRing<Message, 256> messages_;
+  std::atomic<std::size_t> dropped_{0};
+  std::unordered_map<std::uint64_t, Summary> summaries_;
+
+  // Written by push/popGroup and read by the synchronous callback, both on
+  // the GL thread.
+  std::array<char, 128> groupPath_{};
+  std::size_t groupPathLength_ = 0;
+  std::vector<std::size_t> groupLengths_;
+};
+
+// Brackets a section of GL work with a debug group, so driver messages
+// raised inside it are attributed to `label`.
+class DebugGroup {
+public:
+  explicit DebugGroup(std::string_view label) {
+    DebugOutput::getInstance().pushGroup(label);
+  }
+  ~DebugGroup() { DebugOutput::getInstance().popGroup(); }
+
+  DebugGroup(const DebugGroup &) = delete;
+  DebugGroup &operator=(const DebugGroup &) = delete;
+  DebugGroup(DebugGroup &&) = delete;
+  DebugGroup &operator=(DebugGroup &&) = delete;
+};
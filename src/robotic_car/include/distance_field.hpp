@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "job_system.hpp"
+#include "mapped_file.hpp"
+#include "summed_area_table.hpp"
+#include "track_image.hpp"
+
+// Signed Euclidean distance from every pixel of a track image to the edge
+// of the line, in pixels: negative on the line, positive off it. A pixel is
+// line when its luminance is 128 or less, the same test the sensors apply to
+// their box average.
+//
+// The transform is Felzenszwalb and Huttenlocher's exact one: the squared
+// distance along each column, then along each row of that, each pass taking
+// the lower envelope of one parabola per pixel in linear time. Columns, and
+// then rows, are independent of each other, so each pass is a parallelFor.
+//
+// load() keeps the field in a cache file next to the image and maps that on
+// later runs instead of building it again. The cache holds the raw floats
+// in native byte order behind a small header, and is rebuilt whenever the
+// image's bytes change.
+class DistanceField {
+public:
+  struct Sample {
+    float distance;
+    // Change of `distance` per pixel along columns (x) and rows (y).
+    glm::vec2 gradient;
+  };
+
+  // `pixels` is row-major with `channels` bytes per pixel, as for
+  // SummedAreaTable. Both passes run on `jobs` when given.
+  DistanceField(const unsigned char *pixels, int width, int height,
+                int channels, JobSystem *jobs = nullptr)
+      : width_(width), height_(height) {
+    if (width <= 0 || height <= 0) {
+      throw std::runtime_error("Distance field of an empty image");
+    }
+    std::size_t count = static_cast<std::size_t>(width) * height;
+    // Squared distance to the nearest line pixel, and to the nearest pixel
+    // that is not line, seeded with zero at those pixels.
+    std::vector<float> toLine(count);
+    std::vector<float> toBackground(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      bool line = SummedAreaTable::luminance(pixels + i * channels,
+                                             channels) <= 128;
+      toLine[i] = line ? 0.0f : infinite;
+      toBackground[i] = line ? infinite : 0.0f;
+    }
+
+    forEachRange(jobs, static_cast<std::size_t>(width),
+                 [&](std::size_t begin, std::size_t end) {
+                   Scratch scratch(static_cast<std::size_t>(height));
+                   for (std::size_t column = begin; column < end; ++column) {
+                     transformColumn(toLine, column, scratch);
+                     transformColumn(toBackground, column, scratch);
+                   }
+                 });
+    forEachRange(jobs, static_cast<std::size_t>(height),
+                 [&](std::size_t begin, std::size_t end) {
+                   Scratch scratch(static_cast<std::size_t>(width));
+                   for (std::size_t row = begin; row < end; ++row) {
+                     transformRow(toLine, row, scratch);
+                     transformRow(toBackground, row, scratch);
+                   }
+                 });
+
+    // Distances are between pixel centres; the edge of the line lies half
+    // a pixel in from the centre of the last line pixel.
+    for (std::size_t i = 0; i < count; ++i) {
+      toLine[i] = toBackground[i] == 0.0f
+                      ? std::sqrt(toLine[i]) - 0.5f
+                      : 0.5f - std::sqrt(toBackground[i]);
+    }
+    built_ = std::move(toLine);
+    data_ = built_.data();
+  }
+
+  // The field of the image at `imagePath`, mapped from its cache when that
+  // is current and otherwise built and, if the directory is writable,
+  // cached for next time.
+  static DistanceField load(std::string_view imagePath,
+                            JobSystem *jobs = nullptr) {
+    std::uint64_t hash = hashFile(std::string(imagePath));
+    std::string cache = cachePath(imagePath);
+    if (std::optional<DistanceField> cached = map(cache, hash)) {
+      return std::move(*cached);
+    }
+    TrackImage image = loadTrackImage(imagePath);
+    DistanceField field(image.pixels.get(), image.width, image.height,
+                        image.channels, jobs);
+    field.save(cache, hash);
+    return field;
+  }
+
+  static std::string cachePath(std::string_view imagePath) {
+    return std::string(imagePath) + ".sdf";
+  }
+
+  DistanceField(const DistanceField &) = delete;
+  DistanceField &operator=(const DistanceField &) = delete;
+  DistanceField(DistanceField &&) = default;
+  DistanceField &operator=(DistanceField &&) = default;
+
+  // Distance and gradient at a point in pixel units, where pixel (row,
+  // column) covers [column, column + 1) x [row, row + 1): one bilinear
+  // fetch of the four nearest pixel centres. Points off the image take the
+  // value at the nearest edge.
+  Sample sample(float column, float row) const {
+    float x = std::clamp(column - 0.5f, 0.0f, static_cast<float>(width_ - 1));
+    float y = std::clamp(row - 0.5f, 0.0f, static_cast<float>(height_ - 1));
+    int column0 = static_cast<int>(x);
+    int row0 = static_cast<int>(y);
+    int column1 = std::min(column0 + 1, width_ - 1);
+    int row1 = std::min(row0 + 1, height_ - 1);
+    float tx = x - static_cast<float>(column0);
+    float ty = y - static_cast<float>(row0);
+
+    float d00 = at(row0, column0);
+    float d01 = at(row0, column1);
+    float d10 = at(row1, column0);
+    float d11 = at(row1, column1);
+    float bottom = d00 + (d01 - d00) * tx;
+    float top = d10 + (d11 - d10) * tx;
+    return {.distance = bottom + (top - bottom) * ty,
+            .gradient = {d01 - d00 + ((d11 - d10) - (d01 - d00)) * ty,
+                         top - bottom}};
+  }
+
+  float at(int row, int column) const {
+    return data_[static_cast<std::size_t>(row) * width_ + column];
+  }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  // True when the distances are read from a mapped cache file.
+  bool isMapped() const { return mapped_.has_value(); }
+
+  // Writes the cache under a temporary name and renames it into place, so a
+  // run that maps `path` never sees a partly written file. Failing to write
+  // only costs the next run a rebuild, so it is reported, not thrown.
+  bool save(const std::string &path, std::uint64_t sourceHash) const {
+    Header header{.magic = magic,
+                  .version = version,
+                  .width = width_,
+                  .height = height_,
+                  .sourceHash = sourceHash};
+    std::string temporary = path + ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char *>(data_),
+                 static_cast<std::streamsize>(sizeof(float) * width_ *
+                                              height_));
+      if (!file) {
+        return false;
+      }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+      std::filesystem::remove(temporary, error);
+      return false;
+    }
+    return true;
+  }
+
+private:
+  static constexpr float infinite = 1e20f;
+  static constexpr std::array<char, 8> magic = {'T', 'R', 'A', 'C',
+                                                'K', 'S', 'D', 'F'};
+  static constexpr std::uint32_t version = 1;
+
+  // 32 bytes, so the floats after it stay aligned in the mapping.
+  struct Header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::int32_t width;
+    std::int32_t height;
+    std::uint32_t reserved = 0;
+    std::uint64_t sourceHash;
+  };
+  static_assert(sizeof(Header) == 32);
+
+  // Working memory for one 1D transform: the envelope's parabola vertices
+  // and the boundaries between them.
+  struct Scratch {
+    explicit Scratch(std::size_t size)
+        : values(size), vertices(size), boundaries(size + 1) {}
+    std::vector<float> values;
+    std::vector<int> vertices;
+    std::vector<float> boundaries;
+  };
+
+  explicit DistanceField(MappedFile file, const Header &header)
+      : width_(header.width), height_(header.height), mapped_(std::move(file)) {
+    data_ = reinterpret_cast<const float *>(mapped_->bytes().data() +
+                                            sizeof(Header));
+  }
+
+  static std::optional<DistanceField> map(const std::string &path,
+                                          std::uint64_t sourceHash) {
+    if (!std::filesystem::exists(path)) {
+      return std::nullopt;
+    }
+    try {
+      MappedFile file(path);
+      std::span<const std::byte> bytes = file.bytes();
+      Header header;
+      if (bytes.size() < sizeof(header)) {
+        return std::nullopt;
+      }
+      std::memcpy(&header, bytes.data(), sizeof(header));
+      if (header.magic != magic || header.version != version ||
+          header.sourceHash != sourceHash || header.width <= 0 ||
+          header.height <= 0 ||
+          bytes.size() != sizeof(header) + sizeof(float) *
+                                               static_cast<std::size_t>(
+                                                   header.width) *
+                                               header.height) {
+        return std::nullopt;
+      }
+      return DistanceField(std::move(file), header);
+    } catch (const std::runtime_error &) {
+      return std::nullopt;
+    }
+  }
+
+  // 64-bit FNV-1a of the file's bytes.
+  static std::uint64_t hashFile(const std::string &path) {
+    MappedFile file(path);
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (std::byte byte : file.bytes()) {
+      hash = (hash ^ static_cast<std::uint64_t>(byte)) * 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  template <typename Task>
+  static void forEachRange(JobSystem *jobs, std::size_t count,
+                           const Task &task) {
+    constexpr std::size_t grain = 32;
+    if (jobs != nullptr) {
+      jobs->parallelFor(count, grain, task);
+    } else {
+      task(0, count);
+    }
+  }
+
+  void transformColumn(std::vector<float> &grid, std::size_t column,
+                       Scratch &scratch) const {
+    auto stride = static_cast<std::size_t>(width_);
+    for (int row = 0; row < height_; ++row) {
+      scratch.values[row] = grid[row * stride + column];
+    }
+    transform(scratch, height_, grid.data() + column, stride);
+  }
+
+  void transformRow(std::vector<float> &grid, std::size_t row,
+                    Scratch &scratch) const {
+    float *line = grid.data() + row * width_;
+    std::copy(line, line + width_, scratch.values.begin());
+    transform(scratch, width_, line, 1);
+  }
+
+  // The 1D squared distance transform of scratch.values[0, n), written to
+  // out[i * stride]: the lower envelope of the parabolas (q - i)^2 + f(i).
+  static void transform(Scratch &scratch, int n, float *out,
+                        std::size_t stride) {
+    const float *f = scratch.values.data();
+    int *v = scratch.vertices.data();
+    float *z = scratch.boundaries.data();
+    // Where the parabolas from `q` and `p` cross. Far values swamp q^2 in
+    // float, so the arithmetic is in double.
+    auto crossing = [f](int q, int p) {
+      double a = static_cast<double>(f[q]) + static_cast<double>(q) * q;
+      double b = static_cast<double>(f[p]) + static_cast<double>(p) * p;
+      return static_cast<float>((a - b) / (2.0 * (q - p)));
+    };
+    int k = 0;
+    v[0] = 0;
+    z[0] = -infinite;
+    z[1] = infinite;
+    for (int q = 1; q < n; ++q) {
+      float s = crossing(q, v[k]);
+      while (s <= z[k]) {
+        --k;
+        s = crossing(q, v[k]);
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1] = infinite;
+    }
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+      while (z[k + 1] < static_cast<float>(q)) {
+        ++k;
+      }
+      float offset = static_cast<float>(q - v[k]);
+      out[q * stride] = offset * offset + f[v[k]];
+    }
+  }
+
+  int width_ = 0;
+  int height_ = 0;
+  std::vector<float> built_;
+  std::optional<MappedFile> mapped_;
+  const float *data_ = nullptr;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Turns elapsed wall time into a whole number of fixed simulation steps.
+// Time is kept in integer clock ticks, so the same elapsed times always
+// give the same step counts, and the remainder carries over to the next
+// call. When more than `maxSteps` steps are due at once (a long frame, a
+// breakpoint) the extra time is dropped instead of being simulated in a
+// burst that would make the next frame slow too.
+class FixedTimestep {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit FixedTimestep(Clock::duration step, int maxSteps = 8)
+      : step_(step), maxSteps_(maxSteps) {}
+
+  // Adds `elapsed` and returns how many steps to run now.
+  int advance(Clock::duration elapsed) {
+    accumulated_ += elapsed;
+    auto due = accumulated_ / step_;
+    if (due > maxSteps_) {
+      droppedSteps_ += static_cast<std::uint64_t>(due - maxSteps_);
+      accumulated_ -= (due - maxSteps_) * step_;
+      due = maxSteps_;
+    }
+    accumulated_ -= due * step_;
+    steps_ += static_cast<std::uint64_t>(due);
+    return static_cast<int>(due);
+  }
+
+  // How far into the next step the remainder is, in [0, 1).
+  float alpha() const {
+    return std::chrono::duration<float>(accumulated_) /
+           std::chrono::duration<float>(step_);
+  }
+
+  Clock::duration step() const { return step_; }
+  Clock::duration remainder() const { return accumulated_; }
+  float stepSeconds() const {
+    return std::chrono::duration<float>(step_).count();
+  }
+
+  std::uint64_t stepCount() const { return steps_; }
+  std::uint64_t droppedSteps() const { return droppedSteps_; }
+
+private:
+  Clock::duration step_;
+  int maxSteps_;
+  Clock::duration accumulated_{0};
+  std::uint64_t steps_ = 0;
+  std::uint64_t droppedSteps_ = 0;
+};
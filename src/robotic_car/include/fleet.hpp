@@ -0,0 +1,460 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "car_simulation.hpp"
+#include "job_system.hpp"
+#include "summed_area_table.hpp"
+#include "timer_wheel.hpp"
+
+// Allocates on cache-line boundaries, so that ranges of a vector that start
+// on a multiple of a cache line never share a line with each other.
+template <typename T> struct CacheLineAllocator {
+  using value_type = T;
+  static constexpr std::size_t alignment = 64;
+
+  CacheLineAllocator() = default;
+  template <typename U>
+  CacheLineAllocator(const CacheLineAllocator<U> & /*other*/) {}
+
+  T *allocate(std::size_t count) {
+    return static_cast<T *>(
+        ::operator new(count * sizeof(T), std::align_val_t(alignment)));
+  }
+  void deallocate(T *pointer, std::size_t /*count*/) {
+    ::operator delete(pointer, std::align_val_t(alignment));
+  }
+
+  template <typename U>
+  bool operator==(const CacheLineAllocator<U> & /*other*/) const {
+    return true;
+  }
+};
+
+// Many line-following cars on one track, stored as separate arrays per
+// field so that update() can advance eight of them at a time with AVX2:
+// the sensors are read with gathers from the track's summed-area table,
+// the steering rules are a 64-entry table indexed by the six sensor bits
+// instead of a chain of branches, and integration is plain vector
+// arithmetic. Builds without AVX2 run the same steps one car at a time.
+//
+// The cars follow RoboticCar's rules and share one sensor layout. They
+// move in the xz plane and do not collide or otherwise see each other, so
+// each car's step reads only its own state and the track. That makes the
+// parallel update() exact: every car gets the same arithmetic whichever
+// thread runs it, and the result does not depend on the thread count.
+//
+// A car that holds a decision has a timer in the fleet's TimerWheel, which
+// ticks once per update(); cars that hold nothing cost nothing there.
+class Fleet {
+public:
+  enum class Kernel : std::uint8_t {
+    Scalar, // one car at a time
+    Simd    // eight cars at a time; Scalar when built without AVX2
+  };
+
+  static constexpr std::size_t lanes = 8;
+  // Cars per cache line of each field. Parallel updates split the fleet on
+  // multiples of this, so no two threads write to the same line.
+  static constexpr std::size_t carsPerLine =
+      CacheLineAllocator<float>::alignment / sizeof(float);
+
+  explicit Fleet(const SummedAreaTable &track,
+                 const std::array<CarSensor, 6> &sensors =
+                     RoboticCar::defaultSensors())
+      : track_(track), sensors_(sensors) {
+    std::size_t entries = track_.stride() * (track_.height() + 1);
+    if (entries > static_cast<std::size_t>(
+                      std::numeric_limits<std::int32_t>::max())) {
+      throw std::runtime_error("Track image too large for a fleet");
+    }
+    for (std::size_t i = 0; i < sensors_.size(); ++i) {
+      sensorX_[i] = sensors_[i].relative_position.x;
+      sensorZ_[i] = sensors_[i].relative_position.z;
+    }
+    for (unsigned black = 0; black < decisions; ++black) {
+      CarDecision decision = decideAction(black);
+      float degrees = 0.0f;
+      if (decision.action == CarAction::TurnLeft) {
+        degrees = -RoboticCar::turnDegrees;
+      } else if (decision.action == CarAction::TurnRight) {
+        degrees = RoboticCar::turnDegrees;
+      }
+      turnSin_[black] = std::sin(glm::radians(degrees));
+      turnCos_[black] = std::cos(glm::radians(degrees));
+      speedScale_[black] = decision.action == CarAction::Stop ? 0.0f : 1.0f;
+      holdStart_[black] = decision.hold ? -1 : 0;
+    }
+  }
+
+  void reserve(std::size_t count) {
+    std::size_t padded = paddedSize(count);
+    for (Field<float> *field : fields()) {
+      field->reserve(padded);
+    }
+    holding_.reserve(padded);
+    black_.reserve(padded);
+    timers_.reserve(count);
+  }
+
+  // Adds a car and returns its index.
+  std::size_t add(const glm::vec3 &position, const glm::vec3 &direction) {
+    if (size_ == x_.size()) {
+      // Padding lanes never move: zero speed, and a heading that stays
+      // unit length.
+      std::size_t padded = size_ + lanes;
+      x_.resize(padded, 0.0f);
+      y_.resize(padded, 0.0f);
+      z_.resize(padded, 0.0f);
+      directionX_.resize(padded, 0.0f);
+      directionZ_.resize(padded, 1.0f);
+      velocity_.resize(padded, 0.0f);
+      holding_.resize(padded, 0);
+      black_.resize(padded, 0);
+    }
+    glm::vec2 heading = glm::normalize(glm::vec2(direction.x, direction.z));
+    x_[size_] = position.x;
+    y_[size_] = position.y;
+    z_[size_] = position.z;
+    directionX_[size_] = heading.x;
+    directionZ_[size_] = heading.y;
+    velocity_[size_] = RoboticCar::speed;
+    holding_[size_] = 0;
+    black_[size_] = 0;
+    timers_.create(); // the car's hold timer, with the car's index
+    return size_++;
+  }
+
+  std::size_t size() const { return size_; }
+
+  // Every car's x and z, for building a SpatialGrid over the fleet.
+  std::span<const float> xs() const { return {x_.data(), size_}; }
+  std::span<const float> zs() const { return {z_.data(), size_}; }
+
+  bool isStopped(std::size_t car) const { return velocity_[car] == 0.0f; }
+
+  CarState state(std::size_t car) const {
+    CarState state = {.position = {x_[car], y_[car], z_[car]},
+                      .direction = {directionX_[car], 0.0f, directionZ_[car]},
+                      .sensors = sensors_};
+    for (std::size_t i = 0; i < state.sensors.size(); ++i) {
+      bool black = ((black_[car] >> i) & 1) != 0;
+      state.sensors[i].color = black ? CarColor::Blue : CarColor::Green;
+    }
+    return state;
+  }
+
+  static constexpr bool hasSimd() {
+#if defined(__AVX2__)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Advances every car by `deltaTime` seconds, as RoboticCar::update()
+  // does for one. The kernels do the same arithmetic in the same order, but
+  // the compiler may fuse the scalar one's multiply-adds, so they agree only
+  // up to rounding and long runs can drift apart.
+  void update(float deltaTime, Kernel kernel = Kernel::Simd) {
+    expireHolds();
+    holdStarts_.resize(1);
+    updateRange(0, x_.size(), deltaTime, kernel, holdStarts_[0]);
+    startHolds(deltaTime);
+  }
+
+  // As above, on `jobs` in chunks of about `chunkCars` cars that idle
+  // threads steal from each other. Owner thread only, like
+  // JobSystem::parallelFor().
+  void update(float deltaTime, JobSystem &jobs, Kernel kernel = Kernel::Simd,
+              std::size_t chunkCars = 2048) {
+    std::size_t grain =
+        std::max(carsPerLine, chunkCars / carsPerLine * carsPerLine);
+    expireHolds();
+    holdStarts_.resize(jobs.size());
+    jobs.parallelFor(x_.size(), grain,
+                     [this, &jobs, deltaTime, kernel](std::size_t begin,
+                                                      std::size_t end) {
+                       updateRange(begin, end, deltaTime, kernel,
+                                   holdStarts_[jobs.currentThread()]);
+                     });
+    startHolds(deltaTime);
+  }
+
+private:
+  template <typename T> using Field = std::vector<T, CacheLineAllocator<T>>;
+
+  static constexpr unsigned decisions = 64;
+  // A box sum above this means an average above 128: white.
+  static constexpr std::int32_t whiteThreshold =
+      128 * RoboticCar::sensorFootprint * RoboticCar::sensorFootprint;
+  // Track coordinates, in pixels, are clamped to this before conversion to
+  // integers, which keeps the conversion defined without moving any
+  // sensor that is on or near the image.
+  static constexpr float coordinateLimit = 1 << 24;
+
+  static std::size_t paddedSize(std::size_t count) {
+    return (count + lanes - 1) / lanes * lanes;
+  }
+
+  // Cars [begin, end), where `begin` is a multiple of the lane count.
+  // Cars that start holding a decision are appended to `holdStarts`.
+  void updateRange(std::size_t begin, std::size_t end, float deltaTime,
+                   Kernel kernel, std::vector<std::uint32_t> &holdStarts) {
+    std::size_t car = begin;
+#if defined(__AVX2__)
+    if (kernel == Kernel::Simd) {
+      for (; car + lanes <= end; car += lanes) {
+        updateLanes(car, deltaTime, holdStarts);
+      }
+    }
+#else
+    (void)kernel;
+#endif
+    for (; car < std::min(end, size_); ++car) {
+      updateCar(car, deltaTime, holdStarts);
+    }
+  }
+
+  // One tick of the hold timers, before the cars decide.
+  void expireHolds() {
+    timers_.advance(1, [this](TimerWheel::Handle car) { holding_[car] = 0; });
+  }
+
+  // Starts the timers of the cars that began to hold a decision. Holds are
+  // measured in updates, so they last as long as RoboticCar's at the same
+  // fixed step.
+  void startHolds(float deltaTime) {
+    auto ticks = static_cast<TimerWheel::Tick>(
+        std::max(1.0f, std::round(RoboticCar::holdSeconds / deltaTime)));
+    for (std::vector<std::uint32_t> &cars : holdStarts_) {
+      for (std::uint32_t car : cars) {
+        timers_.start(car, ticks);
+      }
+      cars.clear();
+    }
+  }
+
+  std::array<Field<float> *, 6> fields() {
+    return {&x_, &y_, &z_, &directionX_, &directionZ_, &velocity_};
+  }
+
+  // The sum of the track under a sensor at world (x, z), clamped to the
+  // image as SummedAreaTable::average() does.
+  std::uint32_t boxSum(float z, float x) const {
+    auto row0 = static_cast<std::int32_t>(
+                    std::clamp(z * RoboticCar::pixelsPerUnit,
+                               -coordinateLimit, coordinateLimit)) -
+                halfFootprint;
+    auto column0 = static_cast<std::int32_t>(
+                       std::clamp(x * RoboticCar::pixelsPerUnit,
+                                  -coordinateLimit, coordinateLimit)) -
+                   halfFootprint;
+    std::int32_t row1 = std::clamp(row0 + footprint, 0, track_.height());
+    std::int32_t column1 =
+        std::clamp(column0 + footprint, 0, track_.width());
+    row0 = std::clamp(row0, 0, track_.height());
+    column0 = std::clamp(column0, 0, track_.width());
+    const std::uint32_t *sums = track_.data();
+    auto stride = static_cast<std::int32_t>(track_.stride());
+    return sums[row1 * stride + column1] - sums[row0 * stride + column1] -
+           sums[row1 * stride + column0] + sums[row0 * stride + column0];
+  }
+
+  void updateCar(std::size_t car, float deltaTime,
+                 std::vector<std::uint32_t> &holdStarts) {
+    float x = x_[car];
+    float z = z_[car];
+    float directionX = directionX_[car];
+    float directionZ = directionZ_[car];
+
+    unsigned black = 0;
+    for (std::size_t i = 0; i < sensors_.size(); ++i) {
+      float sensorX = x + (sensorX_[i] * directionZ + sensorZ_[i] * directionX);
+      float sensorZ = z + (sensorZ_[i] * directionZ - sensorX_[i] * directionX);
+      auto sum = static_cast<std::int32_t>(boxSum(sensorZ, sensorX));
+      black |= sum > whiteThreshold ? 0u : 1u << i;
+    }
+    black_[car] = static_cast<std::int32_t>(black);
+
+    unsigned index = holding_[car] != 0 ? 0u : black;
+    float s = turnSin_[index];
+    float c = turnCos_[index];
+    float turnedX = c * directionX + s * directionZ;
+    float turnedZ = c * directionZ - s * directionX;
+    if (s != 0.0f) {
+      float length = std::sqrt(turnedX * turnedX + turnedZ * turnedZ);
+      turnedX /= length;
+      turnedZ /= length;
+    }
+    float velocity = velocity_[car] * speedScale_[index];
+
+    if (holdStart_[index] != 0) {
+      holding_[car] = -1;
+      holdStarts.push_back(static_cast<std::uint32_t>(car));
+    }
+    velocity_[car] = velocity;
+    directionX_[car] = turnedX;
+    directionZ_[car] = turnedZ;
+    x_[car] = x + velocity * deltaTime * turnedX;
+    z_[car] = z + velocity * deltaTime * turnedZ;
+  }
+
+#if defined(__AVX2__)
+  __m256i boxSums(__m256 z, __m256 x) const {
+    auto toPixels = [](__m256 coordinate) {
+      __m256 pixels =
+          _mm256_mul_ps(coordinate, _mm256_set1_ps(RoboticCar::pixelsPerUnit));
+      pixels = _mm256_max_ps(pixels, _mm256_set1_ps(-coordinateLimit));
+      pixels = _mm256_min_ps(pixels, _mm256_set1_ps(coordinateLimit));
+      return _mm256_sub_epi32(_mm256_cvttps_epi32(pixels),
+                              _mm256_set1_epi32(halfFootprint));
+    };
+    auto clamp = [](__m256i value, std::int32_t limit) {
+      return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()),
+                              _mm256_set1_epi32(limit));
+    };
+    __m256i row0 = toPixels(z);
+    __m256i column0 = toPixels(x);
+    __m256i row1 = clamp(
+        _mm256_add_epi32(row0, _mm256_set1_epi32(footprint)), track_.height());
+    __m256i column1 =
+        clamp(_mm256_add_epi32(column0, _mm256_set1_epi32(footprint)),
+              track_.width());
+    row0 = clamp(row0, track_.height());
+    column0 = clamp(column0, track_.width());
+
+    __m256i stride =
+        _mm256_set1_epi32(static_cast<std::int32_t>(track_.stride()));
+    row0 = _mm256_mullo_epi32(row0, stride);
+    row1 = _mm256_mullo_epi32(row1, stride);
+    const auto *sums = reinterpret_cast<const int *>(track_.data());
+    auto at = [sums](__m256i row, __m256i column) {
+      return _mm256_i32gather_epi32(sums, _mm256_add_epi32(row, column), 4);
+    };
+    // Wrapping 32-bit arithmetic, as in SummedAreaTable::sum().
+    return _mm256_add_epi32(
+        _mm256_sub_epi32(_mm256_sub_epi32(at(row1, column1),
+                                          at(row0, column1)),
+                         at(row1, column0)),
+        at(row0, column0));
+  }
+
+  void updateLanes(std::size_t car, float deltaTime,
+                   std::vector<std::uint32_t> &holdStarts) {
+    __m256 x = _mm256_loadu_ps(x_.data() + car);
+    __m256 z = _mm256_loadu_ps(z_.data() + car);
+    __m256 directionX = _mm256_loadu_ps(directionX_.data() + car);
+    __m256 directionZ = _mm256_loadu_ps(directionZ_.data() + car);
+
+    __m256i black = _mm256_setzero_si256();
+    for (std::size_t i = 0; i < sensors_.size(); ++i) {
+      __m256 offsetX = _mm256_set1_ps(sensorX_[i]);
+      __m256 offsetZ = _mm256_set1_ps(sensorZ_[i]);
+      __m256 sensorX = _mm256_add_ps(
+          x, _mm256_add_ps(_mm256_mul_ps(offsetX, directionZ),
+                           _mm256_mul_ps(offsetZ, directionX)));
+      __m256 sensorZ = _mm256_add_ps(
+          z, _mm256_sub_ps(_mm256_mul_ps(offsetZ, directionZ),
+                           _mm256_mul_ps(offsetX, directionX)));
+      __m256i white = _mm256_cmpgt_epi32(boxSums(sensorZ, sensorX),
+                                         _mm256_set1_epi32(whiteThreshold));
+      black = _mm256_or_si256(
+          black, _mm256_andnot_si256(white, _mm256_set1_epi32(1 << i)));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(black_.data() + car),
+                        black);
+
+    // A held decision is always "forward", entry 0 of the tables.
+    __m256i holding = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(holding_.data() + car));
+    __m256i index = _mm256_andnot_si256(holding, black);
+    __m256 s = _mm256_i32gather_ps(turnSin_.data(), index, 4);
+    __m256 c = _mm256_i32gather_ps(turnCos_.data(), index, 4);
+    __m256 turnedX = _mm256_add_ps(_mm256_mul_ps(c, directionX),
+                                   _mm256_mul_ps(s, directionZ));
+    __m256 turnedZ = _mm256_sub_ps(_mm256_mul_ps(c, directionZ),
+                                   _mm256_mul_ps(s, directionX));
+    __m256 length = _mm256_sqrt_ps(_mm256_add_ps(
+        _mm256_mul_ps(turnedX, turnedX), _mm256_mul_ps(turnedZ, turnedZ)));
+    __m256 turned = _mm256_cmp_ps(s, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+    turnedX = _mm256_blendv_ps(turnedX, _mm256_div_ps(turnedX, length),
+                               turned);
+    turnedZ = _mm256_blendv_ps(turnedZ, _mm256_div_ps(turnedZ, length),
+                               turned);
+    __m256 velocity =
+        _mm256_mul_ps(_mm256_loadu_ps(velocity_.data() + car),
+                      _mm256_i32gather_ps(speedScale_.data(), index, 4));
+    __m256i holdStart = _mm256_i32gather_epi32(holdStart_.data(), index, 4);
+
+    __m256 distance = _mm256_mul_ps(velocity, _mm256_set1_ps(deltaTime));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(holding_.data() + car),
+                        _mm256_or_si256(holding, holdStart));
+    // Rare: a car sees the hold pattern.
+    auto started = static_cast<unsigned>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(holdStart)));
+    for (; started != 0; started &= started - 1) {
+      std::size_t lane = car + std::countr_zero(started);
+      if (lane < size_) {
+        holdStarts.push_back(static_cast<std::uint32_t>(lane));
+      }
+    }
+    _mm256_storeu_ps(velocity_.data() + car, velocity);
+    _mm256_storeu_ps(directionX_.data() + car, turnedX);
+    _mm256_storeu_ps(directionZ_.data() + car, turnedZ);
+    _mm256_storeu_ps(x_.data() + car,
+                     _mm256_add_ps(x, _mm256_mul_ps(distance, turnedX)));
+    _mm256_storeu_ps(z_.data() + car,
+                     _mm256_add_ps(z, _mm256_mul_ps(distance, turnedZ)));
+  }
+#endif
+
+  static constexpr auto footprint =
+      static_cast<std::int32_t>(RoboticCar::sensorFootprint);
+  static constexpr std::int32_t halfFootprint = footprint / 2;
+
+  const SummedAreaTable &track_;
+  std::array<CarSensor, 6> sensors_;
+  std::array<float, 6> sensorX_{};
+  std::array<float, 6> sensorZ_{};
+
+  // Steering tables indexed by the six sensor bits: the sine and cosine of
+  // the turn, the factor applied to the speed (zero to stop) and whether
+  // to hold the decision (all bits set).
+  alignas(32) std::array<float, decisions> turnSin_{};
+  alignas(32) std::array<float, decisions> turnCos_{};
+  alignas(32) std::array<float, decisions> speedScale_{};
+  alignas(32) std::array<std::int32_t, decisions> holdStart_{};
+
+  // One entry per car, padded to a whole number of lanes.
+  std::size_t size_ = 0;
+  Field<float> x_;
+  Field<float> y_;
+  Field<float> z_;
+  Field<float> directionX_;
+  Field<float> directionZ_;
+  Field<float> velocity_;
+  Field<std::int32_t> holding_; // all bits set while a decision is held
+  Field<std::int32_t> black_;   // bit i set: sensor i + 1 saw black
+
+  // Timer i belongs to car i.
+  TimerWheel timers_;
+  // Cars that started holding during an update, one list per thread.
+  std::vector<std::vector<std::uint32_t>> holdStarts_;
+};
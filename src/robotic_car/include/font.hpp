@@ -11,6 +11,8 @@
 #include <freetype/freetype.h>
 #include <glm/glm.hpp>
 
+#include "gl_state.hpp"
+
 class Font {
 public:
   Font() {
@@ -79,7 +81,7 @@ private:
       // 生成纹理
       GLuint texture = {};
       glGenTextures(1, &texture);
-      glBindTexture(GL_TEXTURE_2D, texture);
+      GLState::getInstance().bindTexture(GL_TEXTURE_2D, texture);
       glTexImage2D(GL_TEXTURE_2D, 0, GL_RED,
                    static_cast<int>(face_->glyph->bitmap.width),
                    static_cast<int>(face_->glyph->bitmap.rows), 0, GL_RED,
@@ -97,6 +99,6 @@ private:
           static_cast<GLuint>(face_->glyph->advance.x)};
       characters_.insert(std::pair<GLchar, Character>(c, character));
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::getInstance().bindTexture(GL_TEXTURE_2D, 0);
   }
 };
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "bounds.hpp"
+
+// The six clip planes of a view-projection matrix (Gribb and Hartmann),
+// normalised and pointing inwards.
+class Frustum {
+public:
+  explicit Frustum(const glm::mat4 &viewProjection) {
+    auto row = [&viewProjection](int i) {
+      return glm::vec4(viewProjection[0][i], viewProjection[1][i],
+                       viewProjection[2][i], viewProjection[3][i]);
+    };
+    planes_ = {row(3) + row(0), row(3) - row(0), row(3) + row(1),
+               row(3) - row(1), row(3) + row(2), row(3) - row(2)};
+    for (glm::vec4 &plane : planes_) {
+      plane /= glm::length(glm::vec3(plane));
+    }
+  }
+
+  bool intersects(const BoundingSphere &sphere) const {
+    for (const glm::vec4 &plane : planes_) {
+      if (glm::dot(glm::vec3(plane), sphere.center) + plane.w <
+          -sphere.radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Tests the box corner furthest along each plane normal.
+  bool intersects(const AABB &box) const {
+    for (const glm::vec4 &plane : planes_) {
+      glm::vec3 corner = {plane.x >= 0.0f ? box.max.x : box.min.x,
+                          plane.y >= 0.0f ? box.max.y : box.min.y,
+                          plane.z >= 0.0f ? box.max.z : box.min.z};
+      if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const std::array<glm::vec4, 6> &planes() const { return planes_; }
+
+private:
+  std::array<glm::vec4, 6> planes_;
+};
+
+// Bounding spheres stored as separate x, y, z and radius arrays so that
+// cull() can test eight of them against a plane with a handful of AVX
+// instructions. Builds without AVX use the same loop one sphere at a time.
+class SphereCuller {
+public:
+  void clear() {
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    radius_.clear();
+  }
+
+  void reserve(std::size_t count) {
+    x_.reserve(count);
+    y_.reserve(count);
+    z_.reserve(count);
+    radius_.reserve(count);
+  }
+
+  std::uint32_t add(const BoundingSphere &sphere) {
+    x_.push_back(sphere.center.x);
+    y_.push_back(sphere.center.y);
+    z_.push_back(sphere.center.z);
+    radius_.push_back(sphere.radius);
+    return static_cast<std::uint32_t>(x_.size() - 1);
+  }
+
+  std::size_t size() const { return x_.size(); }
+
+  // Appends the indices of the spheres that touch `frustum` to `visible`,
+  // in increasing order.
+  void cull(const Frustum &frustum, std::vector<std::uint32_t> &visible) const {
+    const std::array<glm::vec4, 6> &planes = frustum.planes();
+    std::size_t count = x_.size();
+    std::size_t i = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8) {
+      __m256 x = _mm256_loadu_ps(x_.data() + i);
+      __m256 y = _mm256_loadu_ps(y_.data() + i);
+      __m256 z = _mm256_loadu_ps(z_.data() + i);
+      __m256 radius = _mm256_loadu_ps(radius_.data() + i);
+      __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+      __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+      for (const glm::vec4 &plane : planes) {
+        __m256 distance = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)),
+                          _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+            _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)),
+                          _mm256_set1_ps(plane.w)));
+        inside = _mm256_and_ps(
+            inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+      }
+      auto mask = static_cast<unsigned>(_mm256_movemask_ps(inside));
+      while (mask != 0) {
+        visible.push_back(
+            static_cast<std::uint32_t>(i + std::countr_zero(mask)));
+        mask &= mask - 1;
+      }
+    }
+#endif
+    for (; i < count; ++i) {
+      bool inside = true;
+      for (const glm::vec4 &plane : planes) {
+        inside &= x_[i] * plane.x + y_[i] * plane.y + z_[i] * plane.z +
+                      plane.w >=
+                  -radius_[i];
+      }
+      if (inside) {
+        visible.push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+  }
+
+private:
+  std::vector<float> x_;
+  std::vector<float> y_;
+  std::vector<float> z_;
+  std::vector<float> radius_;
+};
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "bounds.hpp"
+#include "gl_capabilities.hpp"
+#include "gl_state.hpp"
+#include "instance_buffer.hpp"
+#include "mesh_loader.hpp"
+#include "stream_buffer.hpp"
+
+// First-fit allocator over a range of `capacity` elements. Free blocks are
+// kept sorted by offset and merged with their neighbours when released, so
+// fragmentation only builds up from interleaved lifetimes.
+class RangeAllocator {
+public:
+  explicit RangeAllocator(std::size_t capacity) : capacity_(capacity) {
+    if (capacity != 0) {
+      free_.emplace(0, capacity);
+    }
+  }
+
+  std::optional<std::size_t> allocate(std::size_t count) {
+    if (count == 0) {
+      return 0;
+    }
+    for (auto iter = free_.begin(); iter != free_.end(); ++iter) {
+      auto [offset, size] = *iter;
+      if (size < count) {
+        continue;
+      }
+      free_.erase(iter);
+      if (size > count) {
+        free_.emplace(offset + count, size - count);
+      }
+      used_ += count;
+      return offset;
+    }
+    return std::nullopt;
+  }
+
+  void release(std::size_t offset, std::size_t count) {
+    if (count == 0) {
+      return;
+    }
+    used_ -= count;
+    auto next = free_.lower_bound(offset);
+    if (next != free_.begin()) {
+      auto previous = std::prev(next);
+      if (previous->first + previous->second == offset) {
+        offset = previous->first;
+        count += previous->second;
+        free_.erase(previous);
+      }
+    }
+    if (next != free_.end() && offset + count == next->first) {
+      count += next->second;
+      free_.erase(next);
+    }
+    free_.emplace(offset, count);
+  }
+
+  // Adds [capacity, newCapacity) as free space.
+  void grow(std::size_t newCapacity) {
+    std::size_t added = newCapacity - capacity_;
+    capacity_ = newCapacity;
+    used_ += added;
+    release(newCapacity - added, added);
+  }
+
+  // Forgets every allocation and marks [used, capacity) free, for callers
+  // that have packed their live data to the front.
+  void reset(std::size_t used) {
+    free_.clear();
+    used_ = used;
+    if (used < capacity_) {
+      free_.emplace(used, capacity_ - used);
+    }
+  }
+
+  std::size_t capacity() const { return capacity_; }
+  std::size_t used() const { return used_; }
+  std::size_t freeBlocks() const { return free_.size(); }
+
+private:
+  std::size_t capacity_;
+  std::size_t used_ = 0;
+  std::map<std::size_t, std::size_t> free_;
+};
+
+// All meshes of one vertex format, packed into one vertex buffer and one
+// index buffer behind a single vertex array. Draws are recorded with draw()
+// and issued by submit() as one glMultiDrawElementsIndirect when the
+// context has it, or as one glDrawElementsInstancedBaseVertex per mesh
+// otherwise. Indices are relative to the mesh, so moving a mesh inside the
+// buffers (grow, defragment) only changes its base vertex.
+class GeometryArena {
+public:
+  using Handle = std::uint32_t;
+
+  struct Range {
+    std::size_t firstVertex;
+    std::size_t vertexCount;
+    std::size_t firstIndex;
+    std::size_t indexCount;
+    Bounds bounds;
+  };
+
+  GeometryArena(GLsizei stride, std::span<const VertexAttribute> layout,
+                std::size_t vertexCapacity = 1 << 16,
+                std::size_t indexCapacity = 1 << 18,
+                std::size_t maxDraws = 1 << 12)
+      : stride_(static_cast<std::size_t>(stride)),
+        layout_(layout.begin(), layout.end()), vertices_(vertexCapacity),
+        indices_(indexCapacity), commandStream_(maxDraws * sizeof(Command)) {
+    vertexBuffer_ = createBuffer(vertexCapacity * stride_);
+    indexBuffer_ = createBuffer(indexCapacity * sizeof(GLuint));
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glCreateVertexArrays(1, &vertexArray_);
+      for (const VertexAttribute &attribute : layout_) {
+        glEnableVertexArrayAttrib(vertexArray_, attribute.index);
+        glVertexArrayAttribFormat(vertexArray_, attribute.index,
+                                  attribute.size, attribute.type,
+                                  attribute.normalized, attribute.offset);
+        glVertexArrayAttribBinding(vertexArray_, attribute.index, 0);
+      }
+    } else {
+      glGenVertexArrays(1, &vertexArray_);
+    }
+    attachBuffers();
+  }
+
+  ~GeometryArena() {
+    GLState &state = GLState::getInstance();
+    state.deleteVertexArray(vertexArray_);
+    glDeleteVertexArrays(1, &vertexArray_);
+    for (GLuint buffer : {vertexBuffer_, indexBuffer_}) {
+      state.deleteBuffer(buffer);
+      glDeleteBuffers(1, &buffer);
+    }
+  }
+  GeometryArena(const GeometryArena &) = delete;
+  GeometryArena &operator=(const GeometryArena &) = delete;
+  GeometryArena(GeometryArena &&) = delete;
+  GeometryArena &operator=(GeometryArena &&) = delete;
+
+  // `vertices` must be in this arena's format; indices start at zero for
+  // the first vertex of the mesh. The buffers grow if there is no room.
+  Handle add(std::span<const std::byte> vertices,
+             std::span<const GLuint> indices, const Bounds &bounds = {}) {
+    std::size_t vertexCount = vertices.size() / stride_;
+    Range range = {.firstVertex = allocate(vertices_, vertexCount, true),
+                   .vertexCount = vertexCount,
+                   .firstIndex = allocate(indices_, indices.size(), false),
+                   .indexCount = indices.size(),
+                   .bounds = bounds};
+    writeBuffer(vertexBuffer_, range.firstVertex * stride_, vertices.size(),
+                vertices.data());
+    writeBuffer(indexBuffer_, range.firstIndex * sizeof(GLuint),
+                indices.size_bytes(), indices.data());
+
+    if (!freeHandles_.empty()) {
+      Handle handle = freeHandles_.back();
+      freeHandles_.pop_back();
+      ranges_[handle] = range;
+      return handle;
+    }
+    ranges_.push_back(range);
+    return static_cast<Handle>(ranges_.size() - 1);
+  }
+
+  // Positions only; the arena's format must be a single vec3.
+  Handle add(const MyMesh &mesh) {
+    if (stride_ != 3 * sizeof(float)) {
+      throw std::runtime_error("Mesh does not match the arena vertex format");
+    }
+    std::vector<float> positions;
+    positions.reserve(mesh.n_vertices() * 3);
+    for (const auto &vertex : mesh.vertices()) {
+      const auto &point = mesh.point(vertex);
+      positions.insert(positions.end(), {point[0], point[1], point[2]});
+    }
+    std::vector<GLuint> indices;
+    indices.reserve(mesh.n_faces() * 3);
+    for (const auto &face : mesh.faces()) {
+      for (const auto &vertex : face.vertices()) {
+        indices.push_back(static_cast<GLuint>(vertex.idx()));
+      }
+    }
+    return add(std::as_bytes(std::span(positions)), indices,
+               Bounds::fromPositions(positions));
+  }
+
+  void remove(Handle handle) {
+    Range &range = ranges_.at(handle);
+    vertices_.release(range.firstVertex, range.vertexCount);
+    indices_.release(range.firstIndex, range.indexCount);
+    range = {};
+    freeHandles_.push_back(handle);
+  }
+
+  // Packs every live mesh to the front of the buffers, in buffer order, so
+  // the free space becomes one block again.
+  void defragment() {
+    std::vector<Handle> order;
+    for (Handle handle = 0; handle < ranges_.size(); ++handle) {
+      const Range &range = ranges_[handle];
+      if (range.vertexCount != 0 || range.indexCount != 0) {
+        order.push_back(handle);
+      }
+    }
+    std::ranges::sort(order, [this](Handle a, Handle b) {
+      return ranges_[a].firstVertex < ranges_[b].firstVertex;
+    });
+
+    GLuint vertexBuffer = createBuffer(vertices_.capacity() * stride_);
+    GLuint indexBuffer = createBuffer(indices_.capacity() * sizeof(GLuint));
+    std::size_t vertexEnd = 0;
+    std::size_t indexEnd = 0;
+    for (Handle handle : order) {
+      Range &range = ranges_[handle];
+      copyBuffer(vertexBuffer_, vertexBuffer, range.firstVertex * stride_,
+                 vertexEnd * stride_, range.vertexCount * stride_);
+      copyBuffer(indexBuffer_, indexBuffer, range.firstIndex * sizeof(GLuint),
+                 indexEnd * sizeof(GLuint), range.indexCount * sizeof(GLuint));
+      range.firstVertex = vertexEnd;
+      range.firstIndex = indexEnd;
+      vertexEnd += range.vertexCount;
+      indexEnd += range.indexCount;
+    }
+    replaceBuffer(vertexBuffer_, vertexBuffer);
+    replaceBuffer(indexBuffer_, indexBuffer);
+    vertices_.reset(vertexEnd);
+    indices_.reset(indexEnd);
+    attachBuffers();
+  }
+
+  // Records one draw of `handle` for the next submit(). `firstInstance`
+  // selects the instances read from the InstanceBuffer passed to submit().
+  void draw(Handle handle, std::size_t instanceCount = 1,
+            std::size_t firstInstance = 0) {
+    const Range &range = ranges_[handle];
+    commands_.push_back(
+        {.count = static_cast<GLuint>(range.indexCount),
+         .instanceCount = static_cast<GLuint>(instanceCount),
+         .firstIndex = static_cast<GLuint>(range.firstIndex),
+         .baseVertex = static_cast<GLint>(range.firstVertex),
+         .baseInstance = static_cast<GLuint>(firstInstance)});
+  }
+
+  // Issues every recorded draw. The bound program and textures are used as
+  // they are.
+  void submit(const InstanceBuffer *instances = nullptr) {
+    if (commands_.empty()) {
+      return;
+    }
+    GLState &state = GLState::getInstance();
+    // A single draw gains nothing from going through the indirect buffer.
+    if (commands_.size() > 1 &&
+        GLCapabilities::getInstance().hasMultiDrawIndirect()) {
+      if (instances != nullptr) {
+        instances->attach(vertexArray_);
+      }
+      std::size_t size = commands_.size() * sizeof(Command);
+      StreamBuffer::Allocation allocation =
+          commandStream_.allocate(size, alignof(Command));
+      std::memcpy(allocation.data.data(), commands_.data(), size);
+      commandStream_.commit(allocation);
+      state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandStream_.buffer());
+      state.bindVertexArray(vertexArray_);
+      glMultiDrawElementsIndirect(
+          GL_TRIANGLES, GL_UNSIGNED_INT,
+          reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
+              static_cast<std::uintptr_t>(allocation.offset)),
+          static_cast<GLsizei>(commands_.size()), 0);
+      state.countDraw();
+    } else {
+      // Base instances only work through the indirect path, so here the
+      // instance attributes are re-pointed for every command instead.
+      for (const Command &command : commands_) {
+        if (instances != nullptr) {
+          instances->attach(vertexArray_, command.baseInstance);
+        }
+        state.bindVertexArray(vertexArray_);
+        glDrawElementsInstancedBaseVertex(
+            GL_TRIANGLES, static_cast<GLsizei>(command.count),
+            GL_UNSIGNED_INT,
+            reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
+                static_cast<std::uintptr_t>(command.firstIndex *
+                                            sizeof(GLuint))),
+            static_cast<GLsizei>(command.instanceCount), command.baseVertex);
+        state.countDraw();
+      }
+    }
+    commands_.clear();
+  }
+
+  const Range &range(Handle handle) const { return ranges_.at(handle); }
+  const RangeAllocator &vertexAllocator() const { return vertices_; }
+  const RangeAllocator &indexAllocator() const { return indices_; }
+  unsigned int vertexArray() const { return vertexArray_; }
+
+private:
+  // Layout fixed by GL for glMultiDrawElementsIndirect.
+  struct Command {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+  };
+
+  std::size_t allocate(RangeAllocator &allocator, std::size_t count,
+                       bool vertices) {
+    if (auto offset = allocator.allocate(count)) {
+      return *offset;
+    }
+    std::size_t capacity = allocator.capacity();
+    std::size_t newCapacity = std::max(capacity * 2, capacity + count);
+    std::size_t elementSize = vertices ? stride_ : sizeof(GLuint);
+    GLuint &buffer = vertices ? vertexBuffer_ : indexBuffer_;
+    GLuint grown = createBuffer(newCapacity * elementSize);
+    copyBuffer(buffer, grown, 0, 0, capacity * elementSize);
+    replaceBuffer(buffer, grown);
+    allocator.grow(newCapacity);
+    attachBuffers();
+    return *allocator.allocate(count);
+  }
+
+  void attachBuffers() {
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glVertexArrayVertexBuffer(vertexArray_, 0, vertexBuffer_, 0,
+                                static_cast<GLsizei>(stride_));
+      glVertexArrayElementBuffer(vertexArray_, indexBuffer_);
+      return;
+    }
+    GLState &state = GLState::getInstance();
+    state.bindVertexArray(vertexArray_);
+    state.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer_);
+    for (const VertexAttribute &attribute : layout_) {
+      glVertexAttribPointer(
+          attribute.index, attribute.size, attribute.type,
+          attribute.normalized, static_cast<GLsizei>(stride_),
+          reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
+              static_cast<std::uintptr_t>(attribute.offset)));
+      glEnableVertexAttribArray(attribute.index);
+    }
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer_);
+    state.bindVertexArray(0);
+  }
+
+  static GLuint createBuffer(std::size_t size) {
+    GLuint buffer = 0;
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glCreateBuffers(1, &buffer);
+      glNamedBufferData(buffer, static_cast<GLsizeiptr>(size), nullptr,
+                        GL_STATIC_DRAW);
+    } else {
+      glGenBuffers(1, &buffer);
+      GLState::getInstance().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+      glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size),
+                   nullptr, GL_STATIC_DRAW);
+    }
+    return buffer;
+  }
+
+  static void writeBuffer(GLuint buffer, std::size_t offset, std::size_t size,
+                          const void *data) {
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glNamedBufferSubData(buffer, static_cast<GLintptr>(offset),
+                           static_cast<GLsizeiptr>(size), data);
+      return;
+    }
+    GLState::getInstance().bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset),
+                    static_cast<GLsizeiptr>(size), data);
+  }
+
+  static void copyBuffer(GLuint from, GLuint to, std::size_t readOffset,
+                         std::size_t writeOffset, std::size_t size) {
+    if (size == 0) {
+      return;
+    }
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glCopyNamedBufferSubData(from, to, static_cast<GLintptr>(readOffset),
+                               static_cast<GLintptr>(writeOffset),
+                               static_cast<GLsizeiptr>(size));
+      return;
+    }
+    GLState &state = GLState::getInstance();
+    state.bindBuffer(GL_COPY_READ_BUFFER, from);
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, to);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        static_cast<GLintptr>(readOffset),
+                        static_cast<GLintptr>(writeOffset),
+                        static_cast<GLsizeiptr>(size));
+  }
+
+  static void replaceBuffer(GLuint &buffer, GLuint replacement) {
+    GLState::getInstance().deleteBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+    buffer = replacement;
+  }
+
+  std::size_t stride_;
+  std::vector<VertexAttribute> layout_;
+  RangeAllocator vertices_;
+  RangeAllocator indices_;
+  std::vector<Range> ranges_;
+  std::vector<Handle> freeHandles_;
+  std::vector<Command> commands_;
+  StreamBuffer commandStream_;
+
+  unsigned int vertexArray_ = 0;
+  unsigned int vertexBuffer_ = 0;
+  unsigned int indexBuffer_ = 0;
+};
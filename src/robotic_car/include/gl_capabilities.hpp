@@ -0,0 +1,54 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdlib>
+#include <string_view>
+
+// Optional GL features, detected once after the context is created. Code
+// that has a faster path for newer contexts checks these flags and keeps the
+// GL 3.3 path as fallback. Setting OPENGL_LEARNING_GL_LEGACY=1 forces the
+// fallback everywhere, which is handy for testing it on a modern driver.
+class GLCapabilities {
+public:
+  static GLCapabilities &getInstance() {
+    static GLCapabilities instance;
+    return instance;
+  }
+
+  void detect() {
+    const char *legacy_env = std::getenv("OPENGL_LEARNING_GL_LEGACY");
+    bool legacy =
+        legacy_env != nullptr && std::string_view(legacy_env) != "0";
+
+    directStateAccess_ =
+        !legacy && (GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access);
+    multiDrawIndirect_ =
+        !legacy && (GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect &&
+                                         GLEW_ARB_base_instance));
+    bufferStorage_ =
+        !legacy && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+    debugOutput_ = GLEW_VERSION_4_3 || GLEW_KHR_debug;
+  }
+
+  // glCreate*, glNamed*, glVertexArray* and glTexture* entry points.
+  bool hasDirectStateAccess() const { return directStateAccess_; }
+
+  // glMultiDrawElementsIndirect with a non-zero base instance.
+  bool hasMultiDrawIndirect() const { return multiDrawIndirect_; }
+
+  // glBufferStorage, for persistently mapped buffers.
+  bool hasBufferStorage() const { return bufferStorage_; }
+
+  // glDebugMessageCallback and debug groups. Not a fast path, so it is not
+  // affected by OPENGL_LEARNING_GL_LEGACY.
+  bool hasDebugOutput() const { return debugOutput_; }
+
+private:
+  GLCapabilities() = default;
+
+  bool directStateAccess_ = false;
+  bool multiDrawIndirect_ = false;
+  bool bufferStorage_ = false;
+  bool debugOutput_ = false;
+};
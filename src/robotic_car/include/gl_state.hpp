@@ -0,0 +1,250 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "gl_capabilities.hpp"
+
+// Shadow copy of the GL bindings we touch. Every bind in this project goes
+// through here so calls that would not change state are never issued, which
+// matters on software rasterisers and remote displays where each GL call is
+// a round trip.
+class GLState {
+public:
+  enum class Call : std::uint8_t {
+    UseProgram,
+    BindVertexArray,
+    BindBuffer,
+    ActiveTexture,
+    BindTexture,
+    Count
+  };
+
+  struct Statistics {
+    std::array<std::size_t, static_cast<std::size_t>(Call::Count)> issued{};
+    std::array<std::size_t, static_cast<std::size_t>(Call::Count)> elided{};
+    std::size_t draws = 0;
+    std::size_t objectsDrawn = 0;
+    std::size_t objectsCulled = 0;
+
+    std::size_t totalIssued() const {
+      std::size_t total = 0;
+      for (std::size_t count : issued) {
+        total += count;
+      }
+      return total;
+    }
+
+    std::size_t totalElided() const {
+      std::size_t total = 0;
+      for (std::size_t count : elided) {
+        total += count;
+      }
+      return total;
+    }
+  };
+
+  ~GLState() = default;
+  GLState(const GLState &) = delete;
+  GLState &operator=(const GLState &) = delete;
+  GLState(GLState &&) = delete;
+  GLState &operator=(GLState &&) = delete;
+
+  static GLState &getInstance() {
+    static GLState instance;
+    return instance;
+  }
+
+  void useProgram(GLuint program) {
+    if (!changed(Call::UseProgram, program_, program)) {
+      return;
+    }
+    glUseProgram(program);
+  }
+
+  void bindVertexArray(GLuint vertexArray) {
+    if (!changed(Call::BindVertexArray, vertexArray_, vertexArray)) {
+      return;
+    }
+    glBindVertexArray(vertexArray);
+    // The element buffer binding is part of the vertex array object.
+    buffers_[slotOf(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+  }
+
+  void bindBuffer(GLenum target, GLuint buffer) {
+    std::size_t slot = slotOf(target);
+    if (slot == untracked) {
+      count(Call::BindBuffer, true);
+      glBindBuffer(target, buffer);
+      return;
+    }
+    if (!changed(Call::BindBuffer, buffers_[slot], buffer)) {
+      return;
+    }
+    glBindBuffer(target, buffer);
+  }
+
+  void activeTexture(GLenum unit) {
+    GLuint index = unit - GL_TEXTURE0;
+    if (!changed(Call::ActiveTexture, activeTexture_, index)) {
+      return;
+    }
+    glActiveTexture(unit);
+  }
+
+  // Binds a 2D texture to `unit`. With direct state access this leaves the
+  // active texture unit alone.
+  void bindTextureUnit(GLuint unit, GLuint texture) {
+    bool tracked = unit < textures_.size();
+    if (tracked && !changed(Call::BindTexture, textures_[unit], texture)) {
+      return;
+    }
+    if (!tracked) {
+      count(Call::BindTexture, true);
+    }
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glBindTextureUnit(unit, texture);
+    } else {
+      activeTexture(GL_TEXTURE0 + unit);
+      glBindTexture(GL_TEXTURE_2D, texture);
+    }
+  }
+
+  // Only GL_TEXTURE_2D bindings are tracked; other targets pass through.
+  void bindTexture(GLenum target, GLuint texture) {
+    if (target != GL_TEXTURE_2D || activeTexture_ >= textures_.size()) {
+      count(Call::BindTexture, true);
+      glBindTexture(target, texture);
+      return;
+    }
+    if (!changed(Call::BindTexture, textures_[activeTexture_], texture)) {
+      return;
+    }
+    glBindTexture(target, texture);
+  }
+
+  // Deleting a bound object resets its binding to zero, and the name may be
+  // handed out again, so the shadow copy has to forget it.
+  void deleteProgram(GLuint program) {
+    if (program != 0 && program_ == program) {
+      program_ = unknown;
+    }
+  }
+
+  void deleteVertexArray(GLuint vertexArray) {
+    if (vertexArray != 0 && vertexArray_ == vertexArray) {
+      vertexArray_ = 0;
+      buffers_[slotOf(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+    }
+  }
+
+  void deleteBuffer(GLuint buffer) {
+    for (GLuint &binding : buffers_) {
+      if (buffer != 0 && binding == buffer) {
+        binding = 0;
+      }
+    }
+  }
+
+  void deleteTexture(GLuint texture) {
+    for (GLuint &binding : textures_) {
+      if (texture != 0 && binding == texture) {
+        binding = 0;
+      }
+    }
+  }
+
+  // Draw calls are not state changes, but counting them next to the binds
+  // shows how well draws are batched.
+  void countDraw() {
+    ++current_.draws;
+    ++total_.draws;
+  }
+
+  // Objects that passed or failed visibility culling this frame.
+  void countObjects(std::size_t drawn, std::size_t culled) {
+    current_.objectsDrawn += drawn;
+    current_.objectsCulled += culled;
+    total_.objectsDrawn += drawn;
+    total_.objectsCulled += culled;
+  }
+
+  // Forget everything, e.g. after code outside this tracker touched the
+  // bindings directly.
+  void invalidate() {
+    program_ = unknown;
+    vertexArray_ = unknown;
+    activeTexture_ = unknown;
+    buffers_.fill(unknown);
+    textures_.fill(unknown);
+  }
+
+  void beginFrame() {
+    lastFrame_ = current_;
+    current_ = {};
+    ++frames_;
+  }
+
+  const Statistics &getFrameStatistics() const { return lastFrame_; }
+  const Statistics &getTotalStatistics() const { return total_; }
+  std::size_t getFrameCount() const { return frames_; }
+
+private:
+  GLState() { invalidate(); }
+
+  static constexpr GLuint unknown = ~0u;
+  static constexpr std::size_t untracked = ~std::size_t{0};
+
+  static std::size_t slotOf(GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER:
+      return 0;
+    case GL_ELEMENT_ARRAY_BUFFER:
+      return 1;
+    case GL_UNIFORM_BUFFER:
+      return 2;
+    case GL_COPY_READ_BUFFER:
+      return 3;
+    case GL_COPY_WRITE_BUFFER:
+      return 4;
+    case GL_DRAW_INDIRECT_BUFFER:
+      return 5;
+    case GL_SHADER_STORAGE_BUFFER:
+      return 6;
+    default:
+      return untracked;
+    }
+  }
+
+  bool changed(Call call, GLuint &binding, GLuint value) {
+    bool issue = binding != value;
+    count(call, issue);
+    binding = value;
+    return issue;
+  }
+
+  void count(Call call, bool issued) {
+    auto index = static_cast<std::size_t>(call);
+    if (issued) {
+      ++current_.issued[index];
+      ++total_.issued[index];
+    } else {
+      ++current_.elided[index];
+      ++total_.elided[index];
+    }
+  }
+
+  GLuint program_;
+  GLuint vertexArray_;
+  GLuint activeTexture_;
+  std::array<GLuint, 7> buffers_;
+  std::array<GLuint, 32> textures_;
+
+  Statistics current_;
+  Statistics lastFrame_;
+  Statistics total_;
+  std::size_t frames_ = 0;
+};
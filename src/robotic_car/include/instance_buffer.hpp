@@ -0,0 +1,104 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include <glm/glm.hpp>
+
+#include "gl_capabilities.hpp"
+#include "gl_state.hpp"
+#include "stream_buffer.hpp"
+
+// Per-instance attributes read by the INSTANCED shader variants:
+//   layout (location = 8) in mat4 aModel;   // locations 8..11
+//   layout (location = 12) in vec4 aColor;
+struct InstanceData {
+  glm::mat4 model;
+  glm::vec4 color;
+};
+
+// Streams InstanceData to the GPU once per frame through a StreamBuffer. A
+// vertex array that reads it gets the attributes above with a divisor of
+// one; locations start at 8 so they never collide with a mesh's own
+// attributes. Each upload lands at a new offset, so attach() has to be
+// called again after upload().
+class InstanceBuffer {
+public:
+  static constexpr GLuint modelLocation = 8;
+  static constexpr GLuint colorLocation = 12;
+  static constexpr GLuint bindingIndex = 1;
+
+  // `capacity` is the most instances uploaded in one frame.
+  explicit InstanceBuffer(std::size_t capacity = 1 << 14)
+      : stream_(capacity * sizeof(InstanceData)) {}
+
+  // Points the instance attributes of `vertexArray` at the last upload,
+  // starting at instance `first`.
+  void attach(GLuint vertexArray, std::size_t first = 0) const {
+    auto base = static_cast<GLintptr>(base_ + first * sizeof(InstanceData));
+    GLuint buffer = stream_.buffer();
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glVertexArrayVertexBuffer(vertexArray, bindingIndex, buffer, base,
+                                sizeof(InstanceData));
+      glVertexArrayBindingDivisor(vertexArray, bindingIndex, 1);
+      for (GLuint column = 0; column < 4; ++column) {
+        glEnableVertexArrayAttrib(vertexArray, modelLocation + column);
+        glVertexArrayAttribFormat(vertexArray, modelLocation + column, 4,
+                                  GL_FLOAT, GL_FALSE,
+                                  column * sizeof(glm::vec4));
+        glVertexArrayAttribBinding(vertexArray, modelLocation + column,
+                                   bindingIndex);
+      }
+      glEnableVertexArrayAttrib(vertexArray, colorLocation);
+      glVertexArrayAttribFormat(vertexArray, colorLocation, 4, GL_FLOAT,
+                                GL_FALSE, offsetof(InstanceData, color));
+      glVertexArrayAttribBinding(vertexArray, colorLocation, bindingIndex);
+      return;
+    }
+
+    GLState &state = GLState::getInstance();
+    state.bindVertexArray(vertexArray);
+    state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint column = 0; column < 4; ++column) {
+      glEnableVertexAttribArray(modelLocation + column);
+      glVertexAttribPointer(
+          modelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+          reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
+              static_cast<std::uintptr_t>(base + column * sizeof(glm::vec4))));
+      glVertexAttribDivisor(modelLocation + column, 1);
+    }
+    glEnableVertexAttribArray(colorLocation);
+    glVertexAttribPointer(
+        colorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
+            static_cast<std::uintptr_t>(base + offsetof(InstanceData, color))));
+    glVertexAttribDivisor(colorLocation, 1);
+    state.bindVertexArray(0);
+  }
+
+  // Copies `instances` into this frame's part of the stream buffer; no
+  // storage is reallocated and the GPU is not waited on.
+  void upload(std::span<const InstanceData> instances) {
+    upload(std::as_bytes(instances));
+  }
+
+  // Same, for instances that were packed into a byte buffer.
+  void upload(std::span<const std::byte> instances) {
+    StreamBuffer::Allocation allocation =
+        stream_.allocate(instances.size(), alignof(glm::vec4));
+    std::memcpy(allocation.data.data(), instances.data(), instances.size());
+    stream_.commit(allocation);
+    base_ = static_cast<std::size_t>(allocation.offset);
+  }
+
+  unsigned int id() const { return stream_.buffer(); }
+  const StreamBuffer &stream() const { return stream_; }
+
+private:
+  StreamBuffer stream_;
+  std::size_t base_ = 0;
+};
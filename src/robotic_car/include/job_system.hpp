@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Work-stealing scheduler. Every thread has its own deque: it pushes and
+// pops at the back, so it keeps working on what it produced last while that
+// is still in cache, and idle threads steal from the front of the others.
+// The thread that creates the JobSystem is its owner and takes part in the
+// work while it waits in helpUntil(); jobs submitted with submitToOwner()
+// only ever run there, which is how GL calls stay on the GL thread.
+class JobSystem {
+public:
+  using Job = std::function<void()>;
+
+  static constexpr std::size_t notAWorker =
+      std::numeric_limits<std::size_t>::max();
+
+  // `threadCount` includes the owner.
+  explicit JobSystem(std::size_t threadCount = std::max(
+                         1u, std::thread::hardware_concurrency()))
+      : queues_(std::max<std::size_t>(threadCount, 1)) {
+    slot_ = {.system = this, .index = 0};
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+      workers_.emplace_back([this, i] {
+        slot_ = {.system = this, .index = i};
+        work(i);
+      });
+    }
+  }
+
+  ~JobSystem() {
+    {
+      std::lock_guard lock(sleepMutex_);
+      stopping_ = true;
+    }
+    sleep_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+  JobSystem(JobSystem &&) = delete;
+  JobSystem &operator=(JobSystem &&) = delete;
+
+  std::size_t size() const { return queues_.size(); }
+
+  // 0 on the owner, 1.. on workers, notAWorker elsewhere.
+  std::size_t currentThread() const {
+    return slot_.system == this ? slot_.index : notAWorker;
+  }
+
+  // Runs `job` on any thread. Safe from any thread.
+  void submit(Job job) {
+    std::size_t index = currentThread();
+    Queue &queue = queues_[index == notAWorker ? 0 : index];
+    {
+      std::lock_guard lock(queue.mutex);
+      queue.jobs.push_back(std::move(job));
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+    wake();
+  }
+
+  // Runs `job` on the owner, the next time it is in helpUntil().
+  void submitToOwner(Job job) {
+    {
+      std::lock_guard lock(ownerMutex_);
+      ownerJobs_.push_back(std::move(job));
+    }
+    wake();
+  }
+
+  // Owner only. Runs jobs until `done()` is true. Whatever makes `done()`
+  // true must call wake() afterwards so a sleeping owner notices.
+  template <typename Done> void helpUntil(Done &&done) {
+    while (!done()) {
+      if (std::optional<Job> job = takeOwnerJob()) {
+        (*job)();
+        continue;
+      }
+      if (std::optional<Job> job = take(0)) {
+        (*job)();
+        continue;
+      }
+      std::unique_lock lock(sleepMutex_);
+      sleep_.wait(lock, [&] {
+        return done() || hasOwnerJob() ||
+               pending_.load(std::memory_order_acquire) != 0;
+      });
+    }
+  }
+
+  void wake() {
+    { std::lock_guard lock(sleepMutex_); }
+    sleep_.notify_all();
+  }
+
+  // Owner only. Calls `task(begin, end)` over [0, count) in ranges that
+  // start on multiples of `grain` and returns once all have finished. The
+  // range is halved recursively: each half goes on the splitting thread's
+  // deque, so idle threads steal large pieces first and split them further
+  // themselves. Range boundaries do not depend on which thread runs what.
+  template <typename Task>
+  void parallelFor(std::size_t count, std::size_t grain, const Task &task) {
+    if (count == 0) {
+      return;
+    }
+    grain = std::max<std::size_t>(grain, 1);
+    std::atomic<std::size_t> finished{0};
+    std::function<void(std::size_t, std::size_t)> split =
+        [this, &split, &finished, &task, count,
+         grain](std::size_t begin, std::size_t end) {
+          while (end - begin > grain) {
+            std::size_t middle =
+                begin + (end - begin + grain - 1) / grain / 2 * grain;
+            submit([&split, middle, end] { split(middle, end); });
+            end = middle;
+          }
+          task(begin, end);
+          // Once the last range is counted the owner may return, taking
+          // `split` and this closure with it, so only locals are used after.
+          JobSystem *system = this;
+          std::size_t total = count;
+          if (finished.fetch_add(end - begin, std::memory_order_acq_rel) +
+                  (end - begin) ==
+              total) {
+            system->wake();
+          }
+        };
+    split(0, count);
+    helpUntil(
+        [&finished, count] {
+          return finished.load(std::memory_order_acquire) == count;
+        });
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  // Zero-initialised like any thread_local, so no member initialisers.
+  struct ThreadSlot {
+    const JobSystem *system;
+    std::size_t index;
+  };
+
+  void work(std::size_t index) {
+    while (true) {
+      if (std::optional<Job> job = take(index)) {
+        (*job)();
+        continue;
+      }
+      std::unique_lock lock(sleepMutex_);
+      sleep_.wait(lock, [this] {
+        return stopping_ || pending_.load(std::memory_order_acquire) != 0;
+      });
+      if (stopping_) {
+        return;
+      }
+    }
+  }
+
+  // Own deque from the back, then the others from the front.
+  std::optional<Job> take(std::size_t index) {
+    if (pending_.load(std::memory_order_acquire) == 0) {
+      return std::nullopt;
+    }
+    {
+      Queue &own = queues_[index];
+      std::lock_guard lock(own.mutex);
+      if (!own.jobs.empty()) {
+        Job job = std::move(own.jobs.back());
+        own.jobs.pop_back();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+      }
+    }
+    for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+      Queue &victim = queues_[(index + offset) % queues_.size()];
+      std::lock_guard lock(victim.mutex);
+      if (!victim.jobs.empty()) {
+        Job job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        pending_.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<Job> takeOwnerJob() {
+    std::lock_guard lock(ownerMutex_);
+    if (ownerJobs_.empty()) {
+      return std::nullopt;
+    }
+    Job job = std::move(ownerJobs_.front());
+    ownerJobs_.pop_front();
+    return job;
+  }
+
+  bool hasOwnerJob() {
+    std::lock_guard lock(ownerMutex_);
+    return !ownerJobs_.empty();
+  }
+
+  inline static thread_local ThreadSlot slot_;
+
+  std::vector<Queue> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<std::size_t> pending_{0};
+  std::mutex ownerMutex_;
+  std::deque<Job> ownerJobs_;
+  std::mutex sleepMutex_;
+  std::condition_variable sleep_;
+  bool stopping_ = false;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only into memory. Pages are read from disk when
+// first touched and shared with every other process mapping the same file,
+// so opening a large file costs next to nothing until it is used.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+#if defined(_WIN32)
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("Failed to open " + path);
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file_, &size) == 0 || size.QuadPart == 0) {
+      close();
+      throw std::runtime_error("Cannot map empty file " + path);
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+      close();
+      throw std::runtime_error("Failed to map " + path);
+    }
+    data_ = static_cast<const std::byte *>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+      throw std::runtime_error("Failed to open " + path);
+    }
+    struct stat status {};
+    if (::fstat(descriptor, &status) != 0 || status.st_size == 0) {
+      ::close(descriptor);
+      throw std::runtime_error("Cannot map empty file " + path);
+    }
+    size_ = static_cast<std::size_t>(status.st_size);
+    void *address =
+        ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+    // The mapping keeps the file alive; the descriptor is not needed.
+    ::close(descriptor);
+    data_ = address == MAP_FAILED ? nullptr
+                                  : static_cast<const std::byte *>(address);
+#endif
+    if (data_ == nullptr) {
+      close();
+      throw std::runtime_error("Failed to map " + path);
+    }
+  }
+
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      close();
+#if defined(_WIN32)
+      file_ = std::exchange(other.file_, INVALID_HANDLE_VALUE);
+      mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  std::span<const std::byte> bytes() const { return {data_, size_}; }
+
+private:
+  void close() {
+#if defined(_WIN32)
+    if (data_ != nullptr) {
+      UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(file_);
+    }
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_ != nullptr) {
+      ::munmap(const_cast<std::byte *>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+#if defined(_WIN32)
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#endif
+  const std::byte *data_ = nullptr;
+  std::size_t size_ = 0;
+};
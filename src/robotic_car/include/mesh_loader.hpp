@@ -5,21 +5,22 @@
 #include <OpenMesh/Core/IO/MeshIO.hh>
 #include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <span>
 #include <string>
 #include <type_traits>
 
+#include "gl_capabilities.hpp"
+#include "gl_state.hpp"
+
 using MyMesh = OpenMesh::TriMesh_ArrayKernelT<>;
 
 class MeshVertexBufferObject {
 public:
   MeshVertexBufferObject(const MyMesh &mesh)
       : vertices_(nullptr), VBO_(0), n_faces_(mesh.n_faces()) {
-
-    glGenBuffers(1, &VBO_);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-
     vertices_ =
         std::make_unique<float[]>( // NOLINT(cppcoreguidelines-avoid-c-arrays)
             mesh.n_faces() * 3 * 6);
@@ -44,12 +45,18 @@ public:
       vertices_[idx++] = point3[2];
     }
 
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        mesh.n_faces() // NOLINT(cppcoreguidelines-narrowing-conversions)
-            * 3 * 3 * sizeof(float),
-        vertices_.get(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    auto size =
+        static_cast<GLsizeiptr>(mesh.n_faces() * 3 * 3 * sizeof(float));
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      // Immutable storage, filled at creation; no binding involved.
+      glCreateBuffers(1, &VBO_);
+      glNamedBufferStorage(VBO_, size, vertices_.get(), 0);
+    } else {
+      glGenBuffers(1, &VBO_);
+      GLState::getInstance().bindBuffer(GL_ARRAY_BUFFER, VBO_);
+      glBufferData(GL_ARRAY_BUFFER, size, vertices_.get(), GL_STATIC_DRAW);
+      GLState::getInstance().bindBuffer(GL_ARRAY_BUFFER, 0);
+    }
   }
 
   template <std::size_t N>
@@ -84,7 +91,7 @@ public:
             n_faces_) *
             3 * 3 * sizeof(float),
         vertices_.get(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::getInstance().bindBuffer(GL_ARRAY_BUFFER, 0);
   }
 
   ~MeshVertexBufferObject() noexcept { release(); }
@@ -105,6 +112,7 @@ public:
 
   void release() {
     if (VBO_) {
+      GLState::getInstance().deleteBuffer(VBO_);
       glDeleteBuffers(1, &VBO_);
       VBO_ = 0;
     }
@@ -117,12 +125,18 @@ public:
     VBO_ = std::exchange(VBO.VBO_, 0u);
   }
 
-  void bind() const { glBindBuffer(GL_ARRAY_BUFFER, VBO_); }
+  void bind() const {
+    GLState::getInstance().bindBuffer(GL_ARRAY_BUFFER, VBO_);
+  }
 
-  void unbind() const { glBindBuffer(GL_ARRAY_BUFFER, 0); }
+  void unbind() const {
+    GLState::getInstance().bindBuffer(GL_ARRAY_BUFFER, 0);
+  }
 
   std::size_t n_faces() const { return n_faces_; }
 
+  unsigned int id() const { return VBO_; }
+
 private:
   std::unique_ptr<float[]> // NOLINT(cppcoreguidelines-avoid-c-arrays)
       vertices_;
@@ -130,15 +144,56 @@ private:
   unsigned int VBO_;
 };
 
+// One vertex attribute read from binding point 0 of a vertex array.
+struct VertexAttribute {
+  GLuint index;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  GLuint offset;
+};
+
 class VertexArrayObject {
 public:
+  // Describes the layout declaratively so it can be set up through direct
+  // state access when available, without binding the array or the buffer.
+  VertexArrayObject(const MeshVertexBufferObject &VBO, GLsizei stride,
+                    std::span<const VertexAttribute> attributes)
+      : VBO_(&VBO) {
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glCreateVertexArrays(1, &VAO_);
+      glVertexArrayVertexBuffer(VAO_, 0, VBO.id(), 0, stride);
+      for (const VertexAttribute &attribute : attributes) {
+        glEnableVertexArrayAttrib(VAO_, attribute.index);
+        glVertexArrayAttribFormat(VAO_, attribute.index, attribute.size,
+                                  attribute.type, attribute.normalized,
+                                  attribute.offset);
+        glVertexArrayAttribBinding(VAO_, attribute.index, 0);
+      }
+      return;
+    }
+
+    glGenVertexArrays(1, &VAO_);
+    GLState::getInstance().bindVertexArray(VAO_);
+    VBO_->bind();
+    for (const VertexAttribute &attribute : attributes) {
+      glVertexAttribPointer(
+          attribute.index, attribute.size, attribute.type,
+          attribute.normalized, stride,
+          reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
+              static_cast<std::uintptr_t>(attribute.offset)));
+      glEnableVertexAttribArray(attribute.index);
+    }
+    GLState::getInstance().bindVertexArray(0);
+  }
+
   template <typename Set>
   VertexArrayObject(const MeshVertexBufferObject &VBO, Set set) : VBO_(&VBO) {
     glGenVertexArrays(1, &VAO_);
-    glBindVertexArray(VAO_);
+    GLState::getInstance().bindVertexArray(VAO_);
     VBO_->bind();
     std::invoke(set);
-    glBindVertexArray(0);
+    GLState::getInstance().bindVertexArray(0);
   }
 
   ~VertexArrayObject() { release(); }
@@ -162,18 +217,33 @@ public:
     if (!VAO_) {
       return;
     }
+    GLState::getInstance().deleteVertexArray(VAO_);
     glDeleteVertexArrays(1, &VAO_);
+    VAO_ = 0;
   }
 
-  void bind() const { glBindVertexArray(VAO_); }
+  void bind() const { GLState::getInstance().bindVertexArray(VAO_); }
 
-  void unbind() const { glBindVertexArray(0); }
+  void unbind() const { GLState::getInstance().bindVertexArray(0); }
 
   void draw() const {
     bind();
     glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(VBO_->n_faces() * 3));
+    GLState::getInstance().countDraw();
+  }
+
+  // Draws the mesh `instances` times; per-instance attributes must already
+  // be attached to this array (see InstanceBuffer::attach).
+  void drawInstanced(GLsizei instances) const {
+    bind();
+    glDrawArraysInstanced(GL_TRIANGLES, 0,
+                          static_cast<GLsizei>(VBO_->n_faces() * 3),
+                          instances);
+    GLState::getInstance().countDraw();
   }
 
+  unsigned int id() const { return VAO_; }
+
 private:
   unsigned int VAO_;
   const MeshVertexBufferObject *VBO_;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded multi-producer, single-consumer queue. Producers claim a slot with
+// one CAS and never block or allocate, so it is safe to push from driver
+// callbacks; a full queue drops the item and tells the caller.
+template <typename T, std::size_t Capacity> class MpscRing {
+  static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+public:
+  MpscRing() {
+    for (std::size_t i = 0; i < Capacity; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpscRing() = default;
+  MpscRing(const MpscRing &) = delete;
+  MpscRing &operator=(const MpscRing &) = delete;
+  MpscRing(MpscRing &&) = delete;
+  MpscRing &operator=(MpscRing &&) = delete;
+
+  // Calls `fill(T &)` on a claimed slot. Returns false if the queue is full.
+  template <typename Fill> bool tryPush(Fill &&fill) {
+    std::size_t position = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot &slot = slots_[position & (Capacity - 1)];
+      std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(sequence) -
+                  static_cast<std::intptr_t>(position);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          fill(slot.value);
+          slot.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Consumer side only. Calls `consume(const T &)` on the oldest item.
+  template <typename Consume> bool tryPop(Consume &&consume) {
+    Slot &slot = slots_[head_ & (Capacity - 1)];
+    std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (static_cast<std::intptr_t>(sequence) -
+            static_cast<std::intptr_t>(head_ + 1) <
+        0) {
+      return false;
+    }
+    consume(static_cast<const T &>(slot.value));
+    slot.sequence.store(head_ + Capacity, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::array<Slot, Capacity> slots_;
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  alignas(64) std::size_t head_ = 0;
+};
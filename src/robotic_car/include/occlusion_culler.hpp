@@ -0,0 +1,303 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "bounds.hpp"
+
+// Software occlusion culling. A few large, low-poly occluders are
+// rasterised into a small depth buffer on the CPU, the buffer is reduced
+// into a max-depth pyramid, and object boxes are tested against the
+// pyramid level where their screen rectangle covers at most 2x2 texels. An
+// object is culled only when its nearest point is behind the farthest
+// occluder depth under its rectangle, so the test never hides anything that
+// is visible; it just misses some objects that are hidden.
+//
+// Depth is window-space z in [0, 1], smaller is nearer. No GL is involved,
+// so the culler runs headless.
+class OcclusionCuller {
+public:
+  struct Statistics {
+    std::size_t occluderTriangles = 0;
+    std::size_t tested = 0;
+    std::size_t occluded = 0;
+  };
+
+  // `width` is rounded up to a multiple of eight for the SIMD rasteriser.
+  explicit OcclusionCuller(int width = 256, int height = 128)
+      : width_((std::max(width, 8) + 7) & ~7), height_(std::max(height, 1)) {
+    int w = width_;
+    int h = height_;
+    while (true) {
+      levels_.push_back({.width = w,
+                         .height = h,
+                         .depth = std::vector<float>(
+                             static_cast<std::size_t>(w) * h, 1.0f)});
+      if (w == 1 && h == 1) {
+        break;
+      }
+      w = std::max(1, (w + 1) / 2);
+      h = std::max(1, (h + 1) / 2);
+    }
+  }
+
+  // Clears the depth buffer for a new view.
+  void beginFrame(const glm::mat4 &viewProjection) {
+    viewProjection_ = viewProjection;
+    std::ranges::fill(levels_.front().depth, 1.0f);
+    statistics_ = {};
+  }
+
+  // Rasterises an indexed triangle mesh. Triangles that cross the near plane
+  // are skipped, which only makes the occluder smaller.
+  void addOccluder(std::span<const glm::vec3> positions,
+                   std::span<const std::uint32_t> indices,
+                   const glm::mat4 &model) {
+    glm::mat4 transform = viewProjection_ * model;
+    projected_.resize(positions.size());
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      projected_[i] = transform * glm::vec4(positions[i], 1.0f);
+    }
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+      rasterize(projected_[indices[i]], projected_[indices[i + 1]],
+                projected_[indices[i + 2]]);
+    }
+  }
+
+  // Call once after the last occluder and before the first test.
+  void buildPyramid() {
+    for (std::size_t level = 1; level < levels_.size(); ++level) {
+      const Level &source = levels_[level - 1];
+      Level &target = levels_[level];
+      for (int y = 0; y < target.height; ++y) {
+        int y0 = std::min(2 * y, source.height - 1);
+        int y1 = std::min(2 * y + 1, source.height - 1);
+        for (int x = 0; x < target.width; ++x) {
+          int x0 = std::min(2 * x, source.width - 1);
+          int x1 = std::min(2 * x + 1, source.width - 1);
+          target.at(x, y) = std::max({source.at(x0, y0), source.at(x1, y0),
+                                      source.at(x0, y1), source.at(x1, y1)});
+        }
+      }
+    }
+  }
+
+  bool isVisible(const AABB &box) {
+    ++statistics_.tested;
+    if (isOccluded(box)) {
+      ++statistics_.occluded;
+      return false;
+    }
+    return true;
+  }
+
+  const Statistics &getStatistics() const { return statistics_; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+  std::size_t levelCount() const { return levels_.size(); }
+  std::span<const float> depth(std::size_t level = 0) const {
+    return levels_[level].depth;
+  }
+
+private:
+  struct Level {
+    int width;
+    int height;
+    std::vector<float> depth;
+
+    float &at(int x, int y) {
+      return depth[static_cast<std::size_t>(y) * width + x];
+    }
+    float at(int x, int y) const {
+      return depth[static_cast<std::size_t>(y) * width + x];
+    }
+  };
+
+  static constexpr float nearW = 1e-5f;
+
+  bool isOccluded(const AABB &box) const {
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+    float minDepth = 1.0f;
+    for (int corner = 0; corner < 8; ++corner) {
+      glm::vec3 point = {(corner & 1) ? box.max.x : box.min.x,
+                         (corner & 2) ? box.max.y : box.min.y,
+                         (corner & 4) ? box.max.z : box.min.z};
+      glm::vec4 clip = viewProjection_ * glm::vec4(point, 1.0f);
+      if (clip.w <= nearW) {
+        return false; // Crosses the near plane; assume visible.
+      }
+      glm::vec3 screen = toScreen(clip);
+      minX = std::min(minX, screen.x);
+      maxX = std::max(maxX, screen.x);
+      minY = std::min(minY, screen.y);
+      maxY = std::max(maxY, screen.y);
+      minDepth = std::min(minDepth, screen.z);
+    }
+
+    // Off screen boxes are the frustum culler's business.
+    int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+    int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+    int x1 = std::min(width_ - 1, static_cast<int>(std::floor(maxX)));
+    int y1 = std::min(height_ - 1, static_cast<int>(std::floor(maxY)));
+    if (x0 > x1 || y0 > y1) {
+      return false;
+    }
+
+    // Coarsest level at which the rectangle still spans at most 2x2 texels.
+    int extent = std::max(x1 - x0, y1 - y0);
+    std::size_t level = 0;
+    while (extent > 1 && level + 1 < levels_.size()) {
+      extent >>= 1;
+      ++level;
+    }
+    const Level &pyramid = levels_[level];
+    x0 >>= level;
+    y0 >>= level;
+    x1 = std::min(x1 >> level, pyramid.width - 1);
+    y1 = std::min(y1 >> level, pyramid.height - 1);
+    float occluderDepth = 0.0f;
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        occluderDepth = std::max(occluderDepth, pyramid.at(x, y));
+      }
+    }
+    return minDepth > occluderDepth;
+  }
+
+  glm::vec3 toScreen(const glm::vec4 &clip) const {
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    return {(ndc.x * 0.5f + 0.5f) * static_cast<float>(width_),
+            (ndc.y * 0.5f + 0.5f) * static_cast<float>(height_),
+            ndc.z * 0.5f + 0.5f};
+  }
+
+  void rasterize(const glm::vec4 &clip0, const glm::vec4 &clip1,
+                 const glm::vec4 &clip2) {
+    if (clip0.w <= nearW || clip1.w <= nearW || clip2.w <= nearW) {
+      return;
+    }
+    glm::vec3 v0 = toScreen(clip0);
+    glm::vec3 v1 = toScreen(clip1);
+    glm::vec3 v2 = toScreen(clip2);
+
+    // Both windings are occluders; orient every triangle the same way.
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (std::abs(area) < 1e-12f) {
+      return;
+    }
+    if (area < 0.0f) {
+      std::swap(v1, v2);
+      area = -area;
+    }
+    ++statistics_.occluderTriangles;
+
+    int minX = std::max(0, static_cast<int>(std::floor(
+                               std::min({v0.x, v1.x, v2.x}))));
+    int maxX = std::min(width_ - 1, static_cast<int>(std::ceil(
+                                        std::max({v0.x, v1.x, v2.x}))));
+    int minY = std::max(0, static_cast<int>(std::floor(
+                               std::min({v0.y, v1.y, v2.y}))));
+    int maxY = std::min(height_ - 1, static_cast<int>(std::ceil(
+                                         std::max({v0.y, v1.y, v2.y}))));
+    if (minX > maxX || minY > maxY) {
+      return;
+    }
+    minX &= ~7;
+
+    // Edge functions e(x, y) = a * x + b * y + c, positive inside, and depth
+    // as a plane over the screen, all evaluated at pixel centres.
+    std::array<Edge, 3> edges = {edgeOf(v1, v2), edgeOf(v2, v0),
+                                 edgeOf(v0, v1)};
+    float inverseArea = 1.0f / area;
+    Edge depth = {
+        .a = (edges[0].a * v0.z + edges[1].a * v1.z + edges[2].a * v2.z) *
+             inverseArea,
+        .b = (edges[0].b * v0.z + edges[1].b * v1.z + edges[2].b * v2.z) *
+             inverseArea,
+        .c = (edges[0].c * v0.z + edges[1].c * v1.z + edges[2].c * v2.z) *
+             inverseArea};
+
+    Level &target = levels_.front();
+    for (int y = minY; y <= maxY; ++y) {
+      float py = static_cast<float>(y) + 0.5f;
+      float *row = &target.at(0, y);
+      for (int x = minX; x <= maxX; x += 8) {
+        spanDepth(row + x, static_cast<float>(x) + 0.5f, py, edges, depth);
+      }
+    }
+  }
+
+  struct Edge {
+    float a;
+    float b;
+    float c;
+  };
+
+  static Edge edgeOf(const glm::vec3 &from, const glm::vec3 &to) {
+    return {.a = from.y - to.y,
+            .b = to.x - from.x,
+            .c = from.x * to.y - from.y * to.x};
+  }
+
+  // Writes the nearer of the stored and triangle depth for eight pixels
+  // starting at x. `row` is inside the buffer because widths are multiples
+  // of eight and spans start eight-aligned.
+  static void spanDepth(float *row, float x, float y,
+                        const std::array<Edge, 3> &edges, const Edge &depth) {
+#if defined(__AVX__)
+    __m256 px = _mm256_add_ps(_mm256_set1_ps(x),
+                              _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256 py = _mm256_set1_ps(y);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (const Edge &edge : edges) {
+      __m256 value = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(edge.a)),
+                        _mm256_mul_ps(py, _mm256_set1_ps(edge.b))),
+          _mm256_set1_ps(edge.c));
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    __m256 z = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(depth.a)),
+                      _mm256_mul_ps(py, _mm256_set1_ps(depth.b))),
+        _mm256_set1_ps(depth.c));
+    __m256 stored = _mm256_loadu_ps(row);
+    _mm256_storeu_ps(row, _mm256_blendv_ps(stored, _mm256_min_ps(stored, z),
+                                           inside));
+#else
+    for (int i = 0; i < 8; ++i) {
+      float px = x + static_cast<float>(i);
+      bool inside = true;
+      for (const Edge &edge : edges) {
+        inside &= edge.a * px + edge.b * y + edge.c >= 0.0f;
+      }
+      if (inside) {
+        row[i] = std::min(row[i], depth.a * px + depth.b * y + depth.c);
+      }
+    }
+#endif
+  }
+
+  int width_;
+  int height_;
+  std::vector<Level> levels_;
+  std::vector<glm::vec4> projected_;
+  glm::mat4 viewProjection_ = glm::mat4(1.0f);
+  Statistics statistics_;
+};
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "car_simulation.hpp"
+#include "distance_field.hpp"
+#include "summed_area_table.hpp"
+#include "thread_pool.hpp"
+
+// Runs one headless car per configuration of its controller and measures
+// how well each follows the line. All runs share one decoded track and its
+// distance field, and run on a ThreadPool, one configuration per task.
+class ParameterSweep {
+public:
+  // The tuned parameters, in this order in a Point.
+  static constexpr std::array<std::string_view, 5> axisNames = {
+      "speed", "turn_degrees", "hold_seconds", "sensor_spread",
+      "sensor_reach"};
+  using Point = std::array<float, axisNames.size()>;
+
+  // A parameter's range, and how many evenly spaced values of it a grid
+  // takes. A range with min == max holds the parameter fixed.
+  struct Axis {
+    float min;
+    float max;
+    int levels = 1;
+  };
+  using Axes = std::array<Axis, axisNames.size()>;
+
+  // Every parameter at the car's default, so a sweep only names what it
+  // varies.
+  static Axes defaultAxes() {
+    auto fixed = [](float value) { return Axis{.min = value, .max = value}; };
+    return {fixed(RoboticCar::speed), fixed(RoboticCar::turnDegrees),
+            fixed(RoboticCar::holdSeconds), fixed(1.0f), fixed(1.0f)};
+  }
+
+  // The car for a point. Spread and reach scale the default sensors' offsets
+  // across and along the car.
+  static RoboticCar::Parameters parameters(const Point &point) {
+    RoboticCar::Parameters parameters{.speed = point[0],
+                                      .turnDegrees = point[1],
+                                      .holdSeconds = point[2]};
+    for (CarSensor &sensor : parameters.sensors) {
+      sensor.relative_position.x *= point[3];
+      sensor.relative_position.z *= point[4];
+    }
+    return parameters;
+  }
+
+  // The full grid: every combination of every axis' levels. An axis of one
+  // level contributes its min.
+  static std::vector<Point> grid(const Axes &axes) {
+    std::vector<Point> points(1);
+    for (std::size_t axis = 0; axis < axes.size(); ++axis) {
+      int levels = std::max(axes[axis].levels, 1);
+      std::vector<Point> next;
+      next.reserve(points.size() * levels);
+      for (const Point &point : points) {
+        for (int level = 0; level < levels; ++level) {
+          float t = levels == 1 ? 0.0f
+                                : static_cast<float>(level) /
+                                      static_cast<float>(levels - 1);
+          Point extended = point;
+          extended[axis] = glm::mix(axes[axis].min, axes[axis].max, t);
+          next.push_back(extended);
+        }
+      }
+      points = std::move(next);
+    }
+    return points;
+  }
+
+  // `count` points drawn uniformly from the box the axes span.
+  static std::vector<Point> random(const Axes &axes, std::size_t count,
+                                   std::uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Point> points(count);
+    for (Point &point : points) {
+      for (std::size_t axis = 0; axis < axes.size(); ++axis) {
+        point[axis] = glm::mix(axes[axis].min, axes[axis].max, unit(generator));
+      }
+    }
+    return points;
+  }
+
+  // `count` points such that, along every axis, each of `count` equal slices
+  // of the range holds exactly one of them: the samples cover each
+  // parameter's whole range as evenly as a grid, without a grid's count.
+  static std::vector<Point> latinHypercube(const Axes &axes, std::size_t count,
+                                           std::uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Point> points(count);
+    std::vector<std::size_t> slices(count);
+    for (std::size_t axis = 0; axis < axes.size(); ++axis) {
+      std::iota(slices.begin(), slices.end(), std::size_t{0});
+      std::shuffle(slices.begin(), slices.end(), generator);
+      for (std::size_t i = 0; i < count; ++i) {
+        float t = (static_cast<float>(slices[i]) + unit(generator)) /
+                  static_cast<float>(count);
+        points[i][axis] = glm::mix(axes[axis].min, axes[axis].max, t);
+      }
+    }
+    return points;
+  }
+
+  struct Settings {
+    double seconds = 120.0; // simulated per configuration
+    float deltaTime = 1.0f / 120.0f;
+    glm::vec3 start = {16.5f, 1.51f, 20.0f};
+    glm::vec3 direction = {0.0f, 0.0f, 1.0f};
+    // Off the track means the car's centre is farther than this from the
+    // line, by default as far out as its outermost default sensor.
+    float offTrackUnits = 2.5f;
+    // A lap ends when the car comes back this close to where it started,
+    // after having been at least lapLeaveUnits away.
+    float lapRadius = 2.0f;
+    float lapLeaveUnits = 10.0f;
+  };
+
+  struct Result {
+    Point point;
+    std::optional<double> lapSeconds; // none if no lap was completed
+    double offTrackSeconds = 0.0;
+    std::uint64_t steps = 0; // simulated, fewer if the car stopped
+    double stepsPerSecond = 0.0;
+    bool stopped = false;
+  };
+
+  // Simulates one configuration for settings.seconds, or until the car
+  // stops.
+  static Result run(const Point &point,
+                    std::shared_ptr<const SummedAreaTable> track,
+                    const DistanceField &field, const Settings &settings) {
+    RoboticCar car(std::move(track), parameters(point));
+    car.setPosition(settings.start);
+    car.setDirection(settings.direction);
+    Result result;
+    result.point = point;
+    auto steps = static_cast<std::uint64_t>(
+        std::llround(settings.seconds / settings.deltaTime));
+    float offTrackPixels = settings.offTrackUnits * RoboticCar::pixelsPerUnit;
+    bool left = false;
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t step = 1; step <= steps; ++step) {
+      car.update(settings.deltaTime);
+      result.steps = step;
+      glm::vec3 position = car.state().position;
+      float toLine = field
+                         .sample(position.x * RoboticCar::pixelsPerUnit,
+                                 position.z * RoboticCar::pixelsPerUnit)
+                         .distance;
+      bool offTrack = toLine > offTrackPixels;
+      if (car.isStopped()) {
+        // A stopped car never moves again: it stays where it is for the
+        // rest of the run, without simulating that.
+        if (offTrack) {
+          result.offTrackSeconds +=
+              static_cast<double>(steps - step + 1) * settings.deltaTime;
+        }
+        break;
+      }
+      if (offTrack) {
+        result.offTrackSeconds += settings.deltaTime;
+      }
+      if (!result.lapSeconds) {
+        glm::vec2 fromStart = {position.x - settings.start.x,
+                               position.z - settings.start.z};
+        float distance = glm::length(fromStart);
+        left = left || distance > settings.lapLeaveUnits;
+        if (left && distance < settings.lapRadius) {
+          result.lapSeconds = static_cast<double>(step) * settings.deltaTime;
+        }
+      }
+    }
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    result.stepsPerSecond =
+        elapsed > 0.0 ? static_cast<double>(result.steps) / elapsed : 0.0;
+    result.stopped = car.isStopped();
+    return result;
+  }
+
+  // Runs every point on `pool`; the results are in the order of `points`.
+  static std::vector<Result>
+  runAll(const std::vector<Point> &points,
+         const std::shared_ptr<const SummedAreaTable> &track,
+         const DistanceField &field, const Settings &settings,
+         ThreadPool &pool) {
+    std::vector<Result> results(points.size());
+    pool.parallelFor(points.size(), [&](std::size_t i) {
+      results[i] = run(points[i], track, field, settings);
+    });
+    return results;
+  }
+
+  static void writeCsv(std::ostream &out, const std::vector<Result> &results) {
+    for (std::string_view name : axisNames) {
+      out << name << ',';
+    }
+    out << "lap_seconds,off_track_seconds,steps,steps_per_second,stopped\n";
+    for (const Result &result : results) {
+      for (float value : result.point) {
+        out << std::format("{},", value);
+      }
+      out << (result.lapSeconds ? std::format("{:.4f}", *result.lapSeconds)
+                                : "")
+          << std::format(",{:.4f},{},{:.0f},{}\n", result.offTrackSeconds,
+                         result.steps, result.stepsPerSecond,
+                         result.stopped ? 1 : 0);
+    }
+  }
+
+  static void writeJson(std::ostream &out, const std::vector<Result> &results) {
+    out << "[\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      const Result &result = results[i];
+      out << "  {";
+      for (std::size_t axis = 0; axis < axisNames.size(); ++axis) {
+        out << std::format("\"{}\": {}, ", axisNames[axis], result.point[axis]);
+      }
+      out << "\"lap_seconds\": "
+          << (result.lapSeconds ? std::format("{:.4f}", *result.lapSeconds)
+                                : "null")
+          << std::format(", \"off_track_seconds\": {:.4f}, \"steps\": {}, "
+                         "\"steps_per_second\": {:.0f}, \"stopped\": {}}}",
+                         result.offTrackSeconds, result.steps,
+                         result.stepsPerSecond, result.stopped)
+          << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+  }
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "geometry_arena.hpp"
+#include "gl_state.hpp"
+#include "instance_buffer.hpp"
+
+// Collects draws for a frame and submits them in an order that suits the
+// GPU rather than the order they were pushed in. Packets are sorted by a
+// 64-bit key, state first and depth last:
+//
+//   63     52 51  44 43     32 31       16 15        0
+//   | program | geom | texture | mesh      | depth     |
+//
+// so consecutive packets share as much state as possible and, within one
+// mesh, opaque geometry is drawn front to back for early depth rejection.
+// Runs of packets for the same mesh become one instanced draw, and all
+// draws between two state changes go to their GeometryArena as one
+// multi-draw.
+//
+// Programs must read their per-instance data through the attributes set up by
+// InstanceBuffer (the INSTANCED shader variants); uniforms shared by the whole
+// frame, like the camera, are set by the caller before submit().
+class RenderQueue {
+public:
+  struct Packet {
+    GLuint program;
+    GeometryArena *geometry;
+    GeometryArena::Handle mesh;
+    GLuint texture; // bound to unit 0, or 0 for none
+    float depth;    // view space distance from the camera
+    InstanceData instance;
+  };
+
+  struct Statistics {
+    std::size_t packets = 0;
+    std::size_t batches = 0;
+    std::size_t passes = 0;
+  };
+
+  // `maxPackets` bounds the packets submitted in one frame.
+  explicit RenderQueue(std::size_t maxPackets = 1 << 14)
+      : buffer_(maxPackets) {}
+  ~RenderQueue() = default;
+  RenderQueue(const RenderQueue &) = delete;
+  RenderQueue &operator=(const RenderQueue &) = delete;
+  RenderQueue(RenderQueue &&) = default;
+  RenderQueue &operator=(RenderQueue &&) = default;
+
+  // Depth outside [near, far] is clamped before it is quantised into the key.
+  void setDepthRange(float near, float far) {
+    near_ = near;
+    far_ = far;
+  }
+
+  void push(const Packet &packet) {
+    keys_.push_back({.key = keyOf(packet),
+                     .packet = static_cast<std::uint32_t>(packets_.size())});
+    packets_.push_back(packet);
+  }
+
+  // Sorts, merges and draws everything pushed since the last submit.
+  void submit() {
+    lastSubmit_ = {.packets = packets_.size(), .batches = 0, .passes = 0};
+    if (packets_.empty()) {
+      return;
+    }
+
+    radixSort();
+
+    // Gather instance data in draw order so each batch is a contiguous range
+    // of one buffer, uploaded once.
+    instances_.clear();
+    batches_.clear();
+    for (const Entry &entry : keys_) {
+      const Packet &packet = packets_[entry.packet];
+      if (batches_.empty() ||
+          !sameState(packets_[batches_.back().packet], packet)) {
+        batches_.push_back({.packet = entry.packet,
+                            .first = instances_.size(),
+                            .count = 0});
+      }
+      ++batches_.back().count;
+      instances_.push_back(packet.instance);
+    }
+    buffer_.upload(instances_);
+
+    GLState &state = GLState::getInstance();
+    const Packet *pass = nullptr;
+    for (const Batch &batch : batches_) {
+      const Packet &packet = packets_[batch.packet];
+      if (pass == nullptr || !samePass(*pass, packet)) {
+        if (pass != nullptr) {
+          pass->geometry->submit(&buffer_);
+        }
+        state.useProgram(packet.program);
+        if (packet.texture != 0) {
+          state.bindTextureUnit(0, packet.texture);
+        }
+        pass = &packet;
+        ++lastSubmit_.passes;
+      }
+      packet.geometry->draw(packet.mesh, batch.count, batch.first);
+    }
+    pass->geometry->submit(&buffer_);
+    lastSubmit_.batches = batches_.size();
+
+    packets_.clear();
+    keys_.clear();
+  }
+
+  const Statistics &getLastSubmit() const { return lastSubmit_; }
+
+  // View space depth of an object's origin, for Packet::depth.
+  static float depthOf(const glm::mat4 &view, const glm::mat4 &model) {
+    return -(view * model[3]).z;
+  }
+
+private:
+  struct Entry {
+    std::uint64_t key;
+    std::uint32_t packet;
+  };
+
+  struct Batch {
+    std::uint32_t packet;
+    std::size_t first;
+    std::size_t count;
+  };
+
+  // Packets that can share one multi-draw.
+  static bool samePass(const Packet &a, const Packet &b) {
+    return a.program == b.program && a.geometry == b.geometry &&
+           a.texture == b.texture;
+  }
+
+  // Packets that can share one instanced draw.
+  static bool sameState(const Packet &a, const Packet &b) {
+    return samePass(a, b) && a.mesh == b.mesh;
+  }
+
+  // GL names and pointers are not small, so each one gets a dense index of
+  // `bits` bits the first time it is seen. Beyond that many distinct values
+  // the rest share the last index: they still draw correctly, they just no
+  // longer sort apart.
+  template <typename Key>
+  static std::uint64_t indexOf(std::unordered_map<Key, std::uint16_t> &indices,
+                               Key name, unsigned bits) {
+    std::size_t limit = (std::size_t{1} << bits) - 1;
+    auto [iter, inserted] = indices.try_emplace(
+        name, static_cast<std::uint16_t>(std::min(indices.size(), limit)));
+    return iter->second;
+  }
+
+  std::uint64_t keyOf(const Packet &packet) {
+    float range = far_ - near_;
+    float normalized =
+        range > 0.0f ? glm::clamp((packet.depth - near_) / range, 0.0f, 1.0f)
+                     : 0.0f;
+    auto depth = static_cast<std::uint64_t>(normalized * 65535.0f);
+    std::uint64_t mesh = std::min<GeometryArena::Handle>(packet.mesh, 0xffff);
+    return indexOf(programs_, packet.program, 12) << 52 |
+           indexOf(geometries_, packet.geometry, 8) << 44 |
+           indexOf(textures_, packet.texture, 12) << 32 | mesh << 16 | depth;
+  }
+
+  // LSD radix sort on 8-bit digits. Digits that are the same for every key,
+  // which is common for the program and geometry fields, are skipped.
+  void radixSort() {
+    std::size_t n = keys_.size();
+    scratch_.resize(n);
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+      std::array<std::size_t, 256> offsets{};
+      for (const Entry &entry : keys_) {
+        ++offsets[(entry.key >> shift) & 0xff];
+      }
+      if (offsets[(keys_.front().key >> shift) & 0xff] == n) {
+        continue;
+      }
+      std::size_t sum = 0;
+      for (std::size_t &offset : offsets) {
+        std::size_t count = offset;
+        offset = sum;
+        sum += count;
+      }
+      for (const Entry &entry : keys_) {
+        scratch_[offsets[(entry.key >> shift) & 0xff]++] = entry;
+      }
+      keys_.swap(scratch_);
+    }
+  }
+
+  float near_ = 0.1f;
+  float far_ = 10000.0f;
+
+  std::vector<Packet> packets_;
+  std::vector<Entry> keys_;
+  std::vector<Entry> scratch_;
+  std::vector<Batch> batches_;
+  std::vector<InstanceData> instances_;
+  InstanceBuffer buffer_;
+
+  std::unordered_map<GLuint, std::uint16_t> programs_;
+  std::unordered_map<GeometryArena *, std::uint16_t> geometries_;
+  std::unordered_map<GLuint, std::uint16_t> textures_;
+
+  Statistics lastSubmit_;
+};
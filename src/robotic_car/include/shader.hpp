@@ -2,10 +2,14 @@
 
 #include <GL/glew.h>
 
+#include <functional>
 #include <iostream>
+#include <span>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
+#include "gl_state.hpp"
 #include "window.hpp"
 
 class Shader {
@@ -17,28 +21,51 @@ public:
     }
   }
 
-  ~Shader() noexcept { glDeleteProgram(programID_); }
+  ~Shader() noexcept {
+    GLState::getInstance().deleteProgram(programID_);
+    glDeleteProgram(programID_);
+  }
 
   Shader(const Shader &) = delete;
   Shader &operator=(const Shader &) = delete;
-  Shader(Shader &&s) noexcept : programID_(s.programID_) { s.programID_ = 0; }
+  Shader(Shader &&s) noexcept
+      : programID_(s.programID_),
+        uniformLocations_(std::move(s.uniformLocations_)) {
+    s.programID_ = 0;
+  }
   Shader &operator=(Shader &&s) noexcept {
     if (this != &s) {
+      GLState::getInstance().deleteProgram(programID_);
+      glDeleteProgram(programID_);
       programID_ = s.programID_;
+      uniformLocations_ = std::move(s.uniformLocations_);
       s.programID_ = 0;
     }
     return *this;
   }
 
-  void use() { glUseProgram(programID_); }
+  void use() { GLState::getInstance().useProgram(programID_); }
 
   template <class Func, class... Args>
   void setUniform(std::string_view name, Func &&func, Args &&...args) {
-    GLint location = glGetUniformLocation(programID_, name.data());
+    GLint location = getUniformLocation(name);
     std::invoke(std::forward<Func>(func), location,
                 std::forward<Args>(args)...);
   }
 
+  // Locations are looked up once per name; per-draw uniform updates then
+  // skip the driver's string lookup.
+  GLint getUniformLocation(std::string_view name) {
+    if (auto iter = uniformLocations_.find(name);
+        iter != uniformLocations_.end()) {
+      return iter->second;
+    }
+    GLint location =
+        glGetUniformLocation(programID_, std::string(name).c_str());
+    uniformLocations_.emplace(name, location);
+    return location;
+  }
+
   unsigned int getProgramID() const { return programID_; }
 
 private:
@@ -85,5 +112,14 @@ private:
   }
 
 private:
+  struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view value) const {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
   unsigned int programID_;
+  std::unordered_map<std::string, GLint, StringHash, std::equal_to<>>
+      uniformLocations_;
 };
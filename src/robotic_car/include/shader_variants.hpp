@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "shader.hpp"
+
+// Builds shader programs from one vertex/fragment source pair plus a set of
+// `#define` features. Each distinct feature set is compiled at most once, on
+// first request; per-draw parameters such as colors are expected to be
+// uniforms or instance attributes rather than separate variants.
+class ShaderVariants {
+public:
+  ShaderVariants(std::string_view vertexSource, std::string_view fragmentSource)
+      : vertexSource_(vertexSource), fragmentSource_(fragmentSource) {}
+
+  ~ShaderVariants() = default;
+  ShaderVariants(const ShaderVariants &) = delete;
+  ShaderVariants &operator=(const ShaderVariants &) = delete;
+  ShaderVariants(ShaderVariants &&) noexcept = default;
+  ShaderVariants &operator=(ShaderVariants &&) noexcept = default;
+
+  // Returns the program for the given feature set, compiling it if this is
+  // the first request. Order and duplicates of `defines` do not matter.
+  Shader &get(std::initializer_list<std::string_view> defines = {}) {
+    std::vector<std::string_view> features(defines);
+    std::ranges::sort(features);
+    auto [first, last] = std::ranges::unique(features);
+    features.erase(first, last);
+
+    std::string key;
+    for (std::string_view feature : features) {
+      key.append(feature);
+      key.push_back('\n');
+    }
+
+    std::uint64_t hash = hashKey(key);
+    if (auto iter = variants_.find(hash); iter != variants_.end()) {
+      if (iter->second.key != key) {
+        throw std::runtime_error("Shader variant hash collision");
+      }
+      return *iter->second.shader;
+    }
+
+    auto shader = std::make_unique<Shader>(inject(vertexSource_, key),
+                                           inject(fragmentSource_, key));
+    Shader &result = *shader;
+    variants_.emplace(hash, Variant{std::move(key), std::move(shader)});
+    return result;
+  }
+
+  std::size_t compiledCount() const { return variants_.size(); }
+
+private:
+  struct Variant {
+    std::string key;
+    std::unique_ptr<Shader> shader;
+  };
+
+  // FNV-1a, stable across runs so variant keys can be logged and compared.
+  static std::uint64_t hashKey(std::string_view key) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c : key) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  // Inserts one `#define` line per feature right after the `#version`
+  // directive, which GLSL requires to stay first.
+  static std::string inject(std::string_view source, std::string_view key) {
+    std::string result(source);
+    std::size_t insert_at = 0;
+    if (std::size_t version = result.find("#version");
+        version != std::string::npos) {
+      if (std::size_t eol = result.find('\n', version);
+          eol != std::string::npos) {
+        insert_at = eol + 1;
+      } else {
+        result.push_back('\n');
+        insert_at = result.size();
+      }
+    }
+
+    std::string defines;
+    std::size_t begin = 0;
+    while (begin < key.size()) {
+      std::size_t end = key.find('\n', begin);
+      defines.append("#define ");
+      defines.append(key.substr(begin, end - begin));
+      defines.push_back('\n');
+      begin = end + 1;
+    }
+    result.insert(insert_at, defines);
+    return result;
+  }
+
+  std::string vertexSource_;
+  std::string fragmentSource_;
+  std::unordered_map<std::uint64_t, Variant> variants_;
+};
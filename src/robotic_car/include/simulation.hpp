@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "car_simulation.hpp"
+#include "fixed_timestep.hpp"
+#include "trajectory_log.hpp"
+#include "triple_buffer.hpp"
+
+// Runs a RoboticCar in fixed steps, independent of the frame rate: every
+// update gets the same delta, so the car follows the same path whatever the
+// frame rate is. Steps are counted out by a FixedTimestep, which caps the
+// catch-up after a long frame.
+//
+// After each batch of steps the car's state, along with its state one step
+// earlier, is published through a TripleBuffer. The render thread samples
+// it without locking or waiting and interpolates between the two, so motion
+// stays smooth when the step and frame rates differ.
+//
+// The steps run either on a thread of their own (start()/stop()) or, when
+// that is not wanted, on the caller's thread through advance(). Either way,
+// the car belongs to the simulation until it is stopped; read it only
+// through sample().
+//
+// With a TrajectoryRecorder attached, every step is also appended to a
+// trajectory log; that only copies the step into the recorder's buffer.
+class Simulation {
+public:
+  using Clock = FixedTimestep::Clock;
+
+  struct Snapshot {
+    CarState previous;
+    CarState current;
+    Clock::time_point time; // when `current` was reached
+    std::uint64_t step = 0;
+  };
+
+  explicit Simulation(RoboticCar &car,
+                      Clock::duration step = std::chrono::microseconds(8333),
+                      int maxCatchUpSteps = 8)
+      : car_(car), timestep_(step, maxCatchUpSteps),
+        snapshots_(Snapshot{.previous = car.state(),
+                            .current = car.state(),
+                            .time = Clock::now(),
+                            .step = 0}),
+        last_(Clock::now()) {}
+
+  ~Simulation() { stop(); }
+  Simulation(const Simulation &) = delete;
+  Simulation &operator=(const Simulation &) = delete;
+  Simulation(Simulation &&) = delete;
+  Simulation &operator=(Simulation &&) = delete;
+
+  // Records every step from now on to `recorder`, or stops recording when
+  // it is null. Call it while the simulation is not running.
+  void setRecorder(TrajectoryRecorder *recorder) { recorder_ = recorder; }
+
+  void start() {
+    if (thread_.joinable()) {
+      return;
+    }
+    running_.store(true, std::memory_order_relaxed);
+    thread_ = std::thread([this] {
+      last_ = Clock::now();
+      while (running_.load(std::memory_order_relaxed)) {
+        Clock::time_point now = Clock::now();
+        advance(now);
+        std::this_thread::sleep_until(now + timestep_.step() -
+                                      timestep_.remainder());
+      }
+    });
+  }
+
+  void stop() {
+    running_.store(false, std::memory_order_relaxed);
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  // Runs the steps that are due at `now` and publishes the result. Called
+  // by the simulation thread, or once a frame when there is none.
+  void advance(Clock::time_point now) {
+    int steps = timestep_.advance(now - last_);
+    last_ = now;
+    if (steps == 0) {
+      return;
+    }
+    float delta = timestep_.stepSeconds();
+    for (int i = 1; i < steps; ++i) {
+      stepCar(delta);
+    }
+    CarState previous = car_.state();
+    stepCar(delta);
+
+    Snapshot &snapshot = snapshots_.back();
+    snapshot.previous = previous;
+    snapshot.current = car_.state();
+    snapshot.time = now - timestep_.remainder();
+    snapshot.step = timestep_.stepCount();
+    snapshots_.publish();
+    steps_.store(timestep_.stepCount(), std::memory_order_relaxed);
+    dropped_.store(timestep_.droppedSteps(), std::memory_order_relaxed);
+  }
+
+  // Render thread only. The car as it was at `now - step`, interpolated
+  // between the last two published steps. Drawing one step in the past is
+  // what lets every frame fall between two known states.
+  CarState sample(Clock::time_point now) {
+    snapshots_.update();
+    const Snapshot &snapshot = snapshots_.front();
+    std::chrono::duration<float> sinceStep = now - snapshot.time;
+    float alpha = std::clamp(sinceStep.count() / timestep_.stepSeconds(),
+                             0.0f, 1.0f);
+    return CarState::interpolate(snapshot.previous, snapshot.current, alpha);
+  }
+
+  Clock::duration step() const { return timestep_.step(); }
+  std::uint64_t stepCount() const {
+    return steps_.load(std::memory_order_relaxed);
+  }
+  // Steps skipped because more than the catch-up limit were due at once.
+  std::uint64_t droppedSteps() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+private:
+  void stepCar(float delta) {
+    car_.update(delta);
+    if (recorder_ != nullptr) {
+      recorder_->record(TrajectoryStep::of(car_));
+    }
+  }
+
+  RoboticCar &car_;
+  TrajectoryRecorder *recorder_ = nullptr;
+  FixedTimestep timestep_;
+  TripleBuffer<Snapshot> snapshots_;
+  Clock::time_point last_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<std::uint64_t> steps_{0};
+  std::atomic<std::uint64_t> dropped_{0};
+};
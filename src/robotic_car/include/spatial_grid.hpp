@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "job_system.hpp"
+
+// Uniform grid over points in the xz plane, for finding the cars near a
+// point, or near each other, without comparing every pair. The plane is cut
+// into square cells and the cells are hashed into a table of buckets sized
+// to the point count, so the grid covers any area and costs memory only for
+// the points in it.
+//
+// build() fills the buckets with a counting sort: count the points per
+// bucket, prefix-sum the counts into bucket starts, then scatter the points
+// to their places. Points end up grouped by bucket and, within a bucket, in
+// index order, whether the build ran on one thread or many, so queries
+// visit points in the same order either way. Each bucket also keeps the
+// points' positions, so a query reads one contiguous run per cell.
+class SpatialGrid {
+public:
+  // Queries are cheapest for a radius up to `cellSize`, which then only
+  // looks at the 3 x 3 cells around the point.
+  explicit SpatialGrid(float cellSize)
+      : cellSize_(cellSize), inverseCellSize_(1.0f / cellSize) {
+    if (!(cellSize > 0.0f)) {
+      throw std::runtime_error("Grid cells must have a positive size");
+    }
+  }
+
+  // Replaces the contents with point i at (xs[i], zs[i]). The counting, the
+  // prefix sum and the scatter run on `jobs` when given.
+  void build(std::span<const float> xs, std::span<const float> zs,
+             JobSystem *jobs = nullptr) {
+    if (xs.size() != zs.size()) {
+      throw std::runtime_error("Grid needs as many x as z coordinates");
+    }
+    std::size_t count = xs.size();
+    // Twice as many buckets as points keeps hash collisions rare.
+    bucketBits_ = std::max(
+        4, static_cast<int>(std::bit_width(std::max<std::size_t>(count, 1) *
+                                           2 - 1)));
+    std::size_t buckets = std::size_t{1} << bucketBits_;
+    buckets_.resize(count);
+    ranks_.resize(count);
+    starts_.assign(buckets + 1, 0);
+    entries_.resize(count);
+
+    // Counting also hands every point its rank within its bucket, so the
+    // scatter needs no atomics and its stores do not wait on each other.
+    forEachRange(jobs, count, pointGrain, [&](std::size_t begin,
+                                             std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        std::uint32_t bucket = bucketOf(cellOf(xs[i]), cellOf(zs[i]));
+        buckets_[i] = bucket;
+        ranks_[i] = increment(jobs, starts_[bucket + 1]);
+      }
+    });
+    prefixSum(jobs);
+    forEachRange(jobs, count, pointGrain, [&](std::size_t begin,
+                                             std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        entries_[starts_[buckets_[i]] + ranks_[i]] = {
+            .x = xs[i],
+            .z = zs[i],
+            .index = static_cast<std::uint32_t>(i),
+            .column = cellOf(xs[i]),
+            .row = cellOf(zs[i])};
+      }
+    });
+    if (jobs != nullptr) {
+      // Threads raced for ranks within a bucket; put each bucket back in
+      // index order. Buckets hold one or two points, so this is cheap.
+      forEachRange(jobs, buckets, bucketGrain, [this](std::size_t begin,
+                                                      std::size_t end) {
+        for (std::size_t bucket = begin; bucket < end; ++bucket) {
+          auto first = entries_.begin() + starts_[bucket];
+          auto last = entries_.begin() + starts_[bucket + 1];
+          if (last - first > 1) {
+            std::sort(first, last, [](const Entry &a, const Entry &b) {
+              return a.index < b.index;
+            });
+          }
+        }
+      });
+    }
+  }
+
+  std::size_t size() const { return entries_.size(); }
+  float cellSize() const { return cellSize_; }
+
+  // Calls `visit(index, distanceSquared)` for every point within `radius`
+  // of `point`, including a point at `point` itself.
+  template <typename Visit>
+  void forEachNear(glm::vec2 point, float radius, Visit &&visit) const {
+    if (entries_.empty()) {
+      return;
+    }
+    std::int32_t column0 = cellOf(point.x - radius);
+    std::int32_t column1 = cellOf(point.x + radius);
+    std::int32_t row0 = cellOf(point.y - radius);
+    std::int32_t row1 = cellOf(point.y + radius);
+    float radiusSquared = radius * radius;
+    for (std::int32_t row = row0; row <= row1; ++row) {
+      for (std::int32_t column = column0; column <= column1; ++column) {
+        forEachInCell(column, row, [&](const Entry &entry) {
+          float distanceSquared = squaredDistance(entry, point);
+          if (distanceSquared <= radiusSquared) {
+            visit(entry.index, distanceSquared);
+          }
+        });
+      }
+    }
+  }
+
+  // Calls `visit(i, j, distanceSquared)` once for every pair of points
+  // within `radius` of each other, with i < j. Pairs come grouped by
+  // bucket, which keeps the reads local.
+  template <typename Visit>
+  void forEachPair(float radius, Visit &&visit) const {
+    if (radius > cellSize_) {
+      for (const Entry &entry : entries_) {
+        forEachNear({entry.x, entry.z}, radius,
+                    [&](std::uint32_t other, float distanceSquared) {
+                      if (entry.index < other) {
+                        visit(entry.index, other, distanceSquared);
+                      }
+                    });
+      }
+      return;
+    }
+    // A pair is at most one cell apart, so each point is paired with the
+    // points after it in its own cell and with all the points of the four
+    // neighbouring cells ahead of it; between them those cover every pair
+    // exactly once.
+    float radiusSquared = radius * radius;
+    auto pair = [&](const Entry &a, const Entry &b) {
+      float distanceSquared = squaredDistance(b, {a.x, a.z});
+      if (distanceSquared <= radiusSquared) {
+        visit(std::min(a.index, b.index), std::max(a.index, b.index),
+              distanceSquared);
+      }
+    };
+    for (std::size_t bucket = 0; bucket + 1 < starts_.size(); ++bucket) {
+      for (std::uint32_t i = starts_[bucket]; i < starts_[bucket + 1]; ++i) {
+        const Entry &entry = entries_[i];
+        std::int32_t column = entry.column;
+        std::int32_t row = entry.row;
+        for (std::uint32_t j = i + 1; j < starts_[bucket + 1]; ++j) {
+          if (inCell(entries_[j], column, row)) {
+            pair(entry, entries_[j]);
+          }
+        }
+        for (auto [dx, dz] : {std::pair{1, 0}, {-1, 1}, {0, 1}, {1, 1}}) {
+          forEachInCell(column + dx, row + dz,
+                        [&](const Entry &other) { pair(entry, other); });
+        }
+      }
+    }
+  }
+
+private:
+  static constexpr std::size_t pointGrain = 4096;
+  static constexpr std::size_t bucketGrain = 16384;
+  // Cell coordinates are clamped to this, which keeps the conversion from
+  // float defined for points however far out.
+  static constexpr float cellLimit = 1 << 30;
+
+  struct Entry {
+    float x;
+    float z;
+    std::uint32_t index;
+    // The cell, kept to tell apart the cells that share a bucket without
+    // converting the position again.
+    std::int32_t column;
+    std::int32_t row;
+  };
+
+  std::int32_t cellOf(float coordinate) const {
+    float cell = std::floor(coordinate * inverseCellSize_);
+    return static_cast<std::int32_t>(
+        std::clamp(cell, -cellLimit, cellLimit));
+  }
+
+  bool inCell(const Entry &entry, std::int32_t column,
+              std::int32_t row) const {
+    return entry.column == column && entry.row == row;
+  }
+
+  // Cells are numbered row by row, 2^((bucketBits_ + 1) / 2) to a row,
+  // and the numbers wrap around the table. Neighbouring cells then sit in
+  // neighbouring buckets, or one row of buckets apart, which keeps queries
+  // in cache, and only cells far apart share a bucket.
+  std::uint32_t bucketOf(std::int32_t column, std::int32_t row) const {
+    int columnBits = (bucketBits_ + 1) / 2;
+    return ((static_cast<std::uint32_t>(row) << columnBits) +
+            static_cast<std::uint32_t>(column)) &
+           ((std::uint32_t{1} << bucketBits_) - 1);
+  }
+
+  static float squaredDistance(const Entry &entry, glm::vec2 point) {
+    float dx = entry.x - point.x;
+    float dz = entry.z - point.y;
+    return dx * dx + dz * dz;
+  }
+
+  template <typename Visit>
+  void forEachInCell(std::int32_t column, std::int32_t row,
+                     Visit &&visit) const {
+    std::uint32_t bucket = bucketOf(column, row);
+    for (std::uint32_t i = starts_[bucket]; i < starts_[bucket + 1]; ++i) {
+      // Other cells can hash to the same bucket.
+      if (inCell(entries_[i], column, row)) {
+        visit(entries_[i]);
+      }
+    }
+  }
+
+  // Adds one to `counter` and returns its old value; atomically when other
+  // threads may be at the same counter.
+  static std::uint32_t increment(JobSystem *jobs, std::uint32_t &counter) {
+    if (jobs == nullptr) {
+      return counter++;
+    }
+    return std::atomic_ref(counter).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Turns the counts in starts_[1..] into each bucket's first place, in
+  // blocks: each block's total, a serial scan of the totals, then each
+  // block's own scan from its offset.
+  void prefixSum(JobSystem *jobs) {
+    std::size_t buckets = starts_.size() - 1;
+    std::size_t blocks = (buckets + bucketGrain - 1) / bucketGrain;
+    std::vector<std::uint32_t> offsets(blocks + 1, 0);
+    forEachRange(jobs, blocks, 1, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t block = begin; block < end; ++block) {
+        auto first = starts_.begin() + 1 + block * bucketGrain;
+        auto last = starts_.begin() + 1 +
+                    std::min(buckets, (block + 1) * bucketGrain);
+        offsets[block + 1] = std::reduce(first, last, std::uint32_t{0});
+      }
+    });
+    std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+    forEachRange(jobs, blocks, 1, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t block = begin; block < end; ++block) {
+        auto first = starts_.begin() + 1 + block * bucketGrain;
+        auto last = starts_.begin() + 1 +
+                    std::min(buckets, (block + 1) * bucketGrain);
+        std::inclusive_scan(first, last, first, std::plus<>(),
+                            offsets[block]);
+      }
+    });
+  }
+
+  template <typename Task>
+  static void forEachRange(JobSystem *jobs, std::size_t count,
+                           std::size_t grain, const Task &task) {
+    if (jobs != nullptr) {
+      jobs->parallelFor(count, grain, task);
+    } else if (count > 0) {
+      task(0, count);
+    }
+  }
+
+  float cellSize_;
+  float inverseCellSize_;
+  int bucketBits_ = 4;
+  // Per point, in index order: the bucket its cell hashes to and its place
+  // among the bucket's points.
+  std::vector<std::uint32_t> buckets_;
+  std::vector<std::uint32_t> ranks_;
+  // Bucket b holds entries_[starts_[b], starts_[b + 1]).
+  std::vector<std::uint32_t> starts_;
+  std::vector<Entry> entries_;
+};
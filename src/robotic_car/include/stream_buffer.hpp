@@ -0,0 +1,224 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "gl_capabilities.hpp"
+#include "gl_state.hpp"
+
+// Ring buffer for data written once per frame and read by the GPU in the
+// same frame: instance attributes, indirect commands, uniform blocks.
+//
+// With ARB_buffer_storage the buffer holds three frame-sized regions and
+// stays persistently and coherently mapped, so allocate() hands out a
+// pointer straight into GPU memory. A fence is inserted when a region is
+// retired and only waited on when the ring comes back round to it, three
+// frames later, so the CPU does not normally wait for the GPU. Without
+// buffer storage the allocations are staged in system memory and
+// commit() copies them into a buffer that is orphaned once per frame.
+//
+// Frames are the ones counted by GLState::beginFrame(). The storage is
+// never reallocated; a frame that needs more than `frameSize` bytes is an
+// error.
+class StreamBuffer {
+public:
+  struct Allocation {
+    std::span<std::byte> data;
+    GLintptr offset; // into buffer()
+  };
+
+  static constexpr std::size_t regionCount = 3;
+
+  explicit StreamBuffer(std::size_t frameSize)
+      : frameSize_(frameSize),
+        persistent_(GLCapabilities::getInstance().hasBufferStorage()) {
+    if (persistent_) {
+      constexpr GLbitfield flags =
+          GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      auto size = static_cast<GLsizeiptr>(frameSize_ * regionCount);
+      if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+        glCreateBuffers(1, &buffer_);
+        glNamedBufferStorage(buffer_, size, nullptr, flags);
+        mapped_ = static_cast<std::byte *>(
+            glMapNamedBufferRange(buffer_, 0, size, flags));
+      } else {
+        glGenBuffers(1, &buffer_);
+        GLState::getInstance().bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        mapped_ = static_cast<std::byte *>(
+            glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+      }
+      if (mapped_ == nullptr) {
+        throw std::runtime_error("Failed to map stream buffer");
+      }
+    } else {
+      staging_.resize(frameSize_);
+      if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+        glCreateBuffers(1, &buffer_);
+      } else {
+        glGenBuffers(1, &buffer_);
+      }
+      orphan();
+    }
+    frame_ = GLState::getInstance().getFrameCount();
+  }
+
+  ~StreamBuffer() noexcept { release(); }
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+  StreamBuffer(StreamBuffer &&other) noexcept
+      : frameSize_(other.frameSize_), persistent_(other.persistent_),
+        buffer_(std::exchange(other.buffer_, 0u)),
+        mapped_(std::exchange(other.mapped_, nullptr)),
+        staging_(std::move(other.staging_)),
+        fences_(std::exchange(other.fences_, {})), region_(other.region_),
+        head_(other.head_), frame_(other.frame_), stalls_(other.stalls_) {}
+  StreamBuffer &operator=(StreamBuffer &&other) noexcept {
+    if (this != &other) {
+      release();
+      frameSize_ = other.frameSize_;
+      persistent_ = other.persistent_;
+      buffer_ = std::exchange(other.buffer_, 0u);
+      mapped_ = std::exchange(other.mapped_, nullptr);
+      staging_ = std::move(other.staging_);
+      fences_ = std::exchange(other.fences_, {});
+      region_ = other.region_;
+      head_ = other.head_;
+      frame_ = other.frame_;
+      stalls_ = other.stalls_;
+    }
+    return *this;
+  }
+
+  void release() {
+    for (GLsync &fence : fences_) {
+      if (fence != nullptr) {
+        glDeleteSync(fence);
+        fence = nullptr;
+      }
+    }
+    if (buffer_) {
+      // Deleting the buffer also unmaps it.
+      GLState::getInstance().deleteBuffer(buffer_);
+      glDeleteBuffers(1, &buffer_);
+      buffer_ = 0;
+    }
+    mapped_ = nullptr;
+  }
+
+  // Reserves `size` bytes in the current frame's region. `alignment` must be
+  // a power of two; use uniformAlignment() for uniform blocks.
+  Allocation allocate(std::size_t size, std::size_t alignment = 16) {
+    advance();
+    std::size_t offset = (head_ + alignment - 1) & ~(alignment - 1);
+    if (offset + size > frameSize_) {
+      throw std::runtime_error("Stream buffer frame size exceeded");
+    }
+    head_ = offset + size;
+    std::byte *base = persistent_ ? mapped_ + region_ * frameSize_
+                                  : staging_.data();
+    std::size_t bufferOffset =
+        persistent_ ? region_ * frameSize_ + offset : offset;
+    return {.data = {base + offset, size},
+            .offset = static_cast<GLintptr>(bufferOffset)};
+  }
+
+  // Makes the bytes written to `allocation` visible to the GPU. Nothing to
+  // do for a coherent mapping.
+  void commit(const Allocation &allocation) {
+    if (persistent_ || allocation.data.empty()) {
+      return;
+    }
+    auto size = static_cast<GLsizeiptr>(allocation.data.size());
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glNamedBufferSubData(buffer_, allocation.offset, size,
+                           allocation.data.data());
+    } else {
+      GLState::getInstance().bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+      glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, size,
+                      allocation.data.data());
+    }
+  }
+
+  // Binds an allocation to an indexed UBO or SSBO binding point.
+  void bindRange(GLenum target, GLuint index,
+                 const Allocation &allocation) const {
+    glBindBufferRange(target, index, buffer_, allocation.offset,
+                      static_cast<GLsizeiptr>(allocation.data.size()));
+  }
+
+  static std::size_t uniformAlignment() {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return static_cast<std::size_t>(alignment);
+  }
+
+  unsigned int buffer() const { return buffer_; }
+  std::size_t frameSize() const { return frameSize_; }
+  bool isPersistent() const { return persistent_; }
+
+  // Times the CPU had to wait for the GPU to release a region.
+  std::size_t getStallCount() const { return stalls_; }
+
+private:
+  // Moves to the next region the first time we allocate in a new frame. All
+  // of last frame's draws have been issued by then, so the fence covers
+  // them.
+  void advance() {
+    std::size_t frame = GLState::getInstance().getFrameCount();
+    if (frame == frame_) {
+      return;
+    }
+    frame_ = frame;
+    head_ = 0;
+    if (!persistent_) {
+      orphan();
+      return;
+    }
+
+    fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region_ = (region_ + 1) % regionCount;
+    GLsync &fence = fences_[region_];
+    if (fence == nullptr) {
+      return;
+    }
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+      ++stalls_;
+      while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  1'000'000); // 1 ms
+      }
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  void orphan() {
+    auto size = static_cast<GLsizeiptr>(frameSize_);
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      glNamedBufferData(buffer_, size, nullptr, GL_STREAM_DRAW);
+    } else {
+      GLState::getInstance().bindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+      glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+  }
+
+  std::size_t frameSize_;
+  bool persistent_;
+  unsigned int buffer_ = 0;
+  std::byte *mapped_ = nullptr;
+  std::vector<std::byte> staging_;
+  std::array<GLsync, regionCount> fences_{};
+  std::size_t region_ = 0;
+  std::size_t head_ = 0;
+  std::size_t frame_ = 0;
+  std::size_t stalls_ = 0;
+};
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "job_system.hpp"
+
+// The work of one frame as a graph of named tasks. Each task declares the
+// resources it reads and writes; edges are derived from those in the order
+// tasks are added, so a task runs after the last writer of everything it
+// touches, and a writer also waits for the readers before it. Tasks with
+// no path between them run at the same time on a JobSystem. Tasks added
+// with Affinity::Owner run on the JobSystem's owner, which is where GL
+// calls go.
+//
+// The graph is built once and run every frame. Each run records when every
+// task started and finished and on which thread, which criticalPath() and
+// TaskGraphTrace turn into a per-frame picture of what bounded the frame.
+class TaskGraph {
+public:
+  using Resource = std::uint32_t;
+  using Task = std::uint32_t;
+  using Clock = std::chrono::steady_clock;
+
+  enum class Affinity : std::uint8_t { Any, Owner };
+
+  struct Timing {
+    Clock::time_point start;
+    Clock::time_point end;
+    std::size_t thread = 0;
+
+    std::chrono::duration<double, std::milli> duration() const {
+      return end - start;
+    }
+  };
+
+  Resource resource(std::string name) {
+    resources_.push_back({.name = std::move(name)});
+    return static_cast<Resource>(resources_.size() - 1);
+  }
+
+  Task add(std::string name, std::initializer_list<Resource> reads,
+           std::initializer_list<Resource> writes, std::function<void()> work,
+           Affinity affinity = Affinity::Any) {
+    auto task = static_cast<Task>(tasks_.size());
+    std::vector<Task> predecessors;
+    for (Resource read : reads) {
+      ResourceState &state = resources_[read];
+      if (state.writer) {
+        predecessors.push_back(*state.writer);
+      }
+      state.readers.push_back(task);
+    }
+    for (Resource write : writes) {
+      ResourceState &state = resources_[write];
+      if (state.writer) {
+        predecessors.push_back(*state.writer);
+      }
+      predecessors.insert(predecessors.end(), state.readers.begin(),
+                          state.readers.end());
+      state.writer = task;
+      state.readers.clear();
+    }
+    std::ranges::sort(predecessors);
+    auto [first, last] = std::ranges::unique(predecessors);
+    predecessors.erase(first, last);
+    std::erase(predecessors, task);
+
+    for (Task predecessor : predecessors) {
+      tasks_[predecessor].successors.push_back(task);
+    }
+    tasks_.push_back({.name = std::move(name),
+                      .work = std::move(work),
+                      .affinity = affinity,
+                      .predecessors = std::move(predecessors)});
+    return task;
+  }
+
+  // Runs every task once and returns when all have finished. Call on the
+  // owner of `jobs`.
+  void run(JobSystem &jobs) {
+    if (tasks_.empty()) {
+      return;
+    }
+    if (waiting_ == nullptr || waitingSize_ != tasks_.size()) {
+      waiting_ = std::make_unique<std::atomic<std::size_t>[]>(tasks_.size());
+      waitingSize_ = tasks_.size();
+    }
+    for (std::size_t i = 0; i < tasks_.size(); ++i) {
+      waiting_[i].store(tasks_[i].predecessors.size(),
+                        std::memory_order_relaxed);
+    }
+    remaining_.store(tasks_.size(), std::memory_order_relaxed);
+    timings_.resize(tasks_.size());
+
+    for (std::size_t i = 0; i < tasks_.size(); ++i) {
+      if (tasks_[i].predecessors.empty()) {
+        schedule(jobs, static_cast<Task>(i));
+      }
+    }
+    jobs.helpUntil(
+        [this] { return remaining_.load(std::memory_order_acquire) == 0; });
+    ++runs_;
+  }
+
+  std::size_t size() const { return tasks_.size(); }
+  const std::string &name(Task task) const { return tasks_[task].name; }
+  Affinity affinity(Task task) const { return tasks_[task].affinity; }
+  const std::vector<Task> &predecessors(Task task) const {
+    return tasks_[task].predecessors;
+  }
+
+  // Of the last run.
+  const Timing &timing(Task task) const { return timings_[task]; }
+  std::size_t runCount() const { return runs_; }
+
+  // The chain of dependent tasks with the largest total run time in the last
+  // run, first task first. No amount of extra threads makes a frame shorter
+  // than this.
+  std::vector<Task> criticalPath() const {
+    if (runs_ == 0) {
+      return {};
+    }
+    // Tasks are added after their predecessors, so index order is a
+    // topological order.
+    std::vector<double> finish(tasks_.size());
+    std::vector<std::optional<Task>> previous(tasks_.size());
+    Task last = 0;
+    for (std::size_t i = 0; i < tasks_.size(); ++i) {
+      double start = 0.0;
+      for (Task predecessor : tasks_[i].predecessors) {
+        if (finish[predecessor] > start) {
+          start = finish[predecessor];
+          previous[i] = predecessor;
+        }
+      }
+      finish[i] = start + timings_[i].duration().count();
+      if (finish[i] > finish[last]) {
+        last = static_cast<Task>(i);
+      }
+    }
+    std::vector<Task> path = {last};
+    while (previous[path.back()]) {
+      path.push_back(*previous[path.back()]);
+    }
+    std::ranges::reverse(path);
+    return path;
+  }
+
+  // One line, e.g. "simulate 0.120 ms -> submit 0.310 ms = 0.430 ms".
+  std::string describeCriticalPath() const {
+    std::string description;
+    double total = 0.0;
+    for (Task task : criticalPath()) {
+      double duration = timings_[task].duration().count();
+      description += std::format("{}{} {:.3f} ms",
+                                 description.empty() ? "" : " -> ",
+                                 tasks_[task].name, duration);
+      total += duration;
+    }
+    return description + std::format(" = {:.3f} ms", total);
+  }
+
+private:
+  struct TaskState {
+    std::string name;
+    std::function<void()> work;
+    Affinity affinity;
+    std::vector<Task> predecessors;
+    std::vector<Task> successors = {};
+  };
+
+  struct ResourceState {
+    std::string name;
+    std::optional<Task> writer = std::nullopt;
+    std::vector<Task> readers = {};
+  };
+
+  void schedule(JobSystem &jobs, Task task) {
+    auto job = [this, &jobs, task] {
+      Timing &timing = timings_[task];
+      timing.thread = jobs.currentThread();
+      timing.start = Clock::now();
+      tasks_[task].work();
+      timing.end = Clock::now();
+      for (Task successor : tasks_[task].successors) {
+        if (waiting_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          schedule(jobs, successor);
+        }
+      }
+      if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        jobs.wake();
+      }
+    };
+    if (tasks_[task].affinity == Affinity::Owner) {
+      jobs.submitToOwner(std::move(job));
+    } else {
+      jobs.submit(std::move(job));
+    }
+  }
+
+  std::vector<TaskState> tasks_;
+  std::vector<ResourceState> resources_;
+  std::vector<Timing> timings_;
+  std::unique_ptr<std::atomic<std::size_t>[]> waiting_;
+  std::size_t waitingSize_ = 0;
+  std::atomic<std::size_t> remaining_{0};
+  std::size_t runs_ = 0;
+};
+
+// Collects task timings over many frames and writes them in the Chrome trace
+// event format, for chrome://tracing or https://ui.perfetto.dev. Every frame
+// is a row of slices per thread; tasks on that frame's critical path are
+// coloured and tagged so the path stands out.
+class TaskGraphTrace {
+public:
+  // Frames beyond `maxFrames` are dropped.
+  explicit TaskGraphTrace(std::size_t maxFrames = 600)
+      : maxFrames_(maxFrames) {}
+
+  void record(const TaskGraph &graph) {
+    if (frames_ >= maxFrames_ || graph.runCount() == 0) {
+      return;
+    }
+    std::vector<TaskGraph::Task> path = graph.criticalPath();
+    for (TaskGraph::Task task = 0; task < graph.size(); ++task) {
+      const TaskGraph::Timing &timing = graph.timing(task);
+      bool critical = std::ranges::find(path, task) != path.end();
+      events_.push_back({.name = graph.name(task),
+                         .start = timing.start,
+                         .end = timing.end,
+                         .thread = timing.thread,
+                         .frame = frames_,
+                         .critical = critical});
+    }
+    ++frames_;
+  }
+
+  void write(std::ostream &out) const {
+    out << "{\"traceEvents\":[\n";
+    TaskGraph::Clock::time_point origin =
+        events_.empty() ? TaskGraph::Clock::time_point{}
+                        : std::ranges::min(events_, {}, &Event::start).start;
+    for (std::size_t i = 0; i < events_.size(); ++i) {
+      const Event &event = events_[i];
+      std::chrono::duration<double, std::micro> start = event.start - origin;
+      std::chrono::duration<double, std::micro> duration =
+          event.end - event.start;
+      out << std::format(
+          "{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":0,"
+          "\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},{}"
+          "\"args\":{{\"frame\":{},\"critical\":{}}}}}{}\n",
+          event.name, event.critical ? "critical" : "task", event.thread,
+          start.count(), duration.count(),
+          event.critical ? "\"cname\":\"terrible\"," : "", event.frame,
+          event.critical, i + 1 < events_.size() ? "," : "");
+    }
+    out << "]}\n";
+  }
+
+  std::size_t frameCount() const { return frames_; }
+
+private:
+  struct Event {
+    std::string name;
+    TaskGraph::Clock::time_point start;
+    TaskGraph::Clock::time_point end;
+    std::size_t thread;
+    std::size_t frame;
+    bool critical;
+  };
+
+  std::size_t maxFrames_;
+  std::size_t frames_ = 0;
+  std::vector<Event> events_;
+};
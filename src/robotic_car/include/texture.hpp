@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <stdexcept>
 #include <string_view>
 #include <type_traits>
+#include <utility>
 
 #ifndef STBI_INCLUDE_STB_IMAGE_H
 #include <stb_image.h>
@@ -12,6 +15,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "bounds.hpp"
+#include "frustum.hpp"
+#include "gl_capabilities.hpp"
+#include "gl_state.hpp"
 #include "shader.hpp"
 #include "window.hpp"
 
@@ -107,52 +114,6 @@ void main()
         1, 2, 3  // second triangle
     };
 
-    shader_.use();
-
-    glGenVertexArrays(1, &VAO_);
-    glGenBuffers(1, &VBO_);
-    glGenBuffers(1, &EBO_);
-
-    glBindVertexArray(VAO_);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(),
-                 GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices.data(),
-                 GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-                          static_cast<void *>(nullptr));
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(
-        1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-        reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
-            3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture coord attribute
-    glVertexAttribPointer(
-        2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
-        reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
-            6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glGenTextures(1, &texture_);
-    glBindTexture(GL_TEXTURE_2D,
-                  texture_); // all upcoming GL_TEXTURE_2D operations now have
-                             // effect on this texture object
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
-                    GL_MIRRORED_REPEAT); // set texture wrapping to GL_REPEAT
-                                         // (default wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                    GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
     GLenum format = GL_RGB;
     if (nrChannels == 1)
       format = GL_RED;
@@ -160,8 +121,6 @@ void main()
       format = GL_RGB;
     else if (nrChannels == 4)
       format = GL_RGBA;
-    // ensure byte-aligned rows for image uploads
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     GLint internalFormat = GL_RGB8;
     if (format == GL_RED)
       internalFormat = GL_R8;
@@ -169,9 +128,16 @@ void main()
       internalFormat = GL_RGB8;
     else if (format == GL_RGBA)
       internalFormat = GL_RGBA8;
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format,
-                 GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    // ensure byte-aligned rows for image uploads
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (GLCapabilities::getInstance().hasDirectStateAccess()) {
+      createNamed(vertices, indices, width, height, format, internalFormat,
+                  data);
+    } else {
+      createBound(vertices, indices, width, height, format, internalFormat,
+                  data);
+    }
     stbi_image_free(data);
 
     // set the sampler uniform to texture unit 0
@@ -181,6 +147,11 @@ void main()
       glUniform1i(texLoc, 0);
     }
 
+    bounds_ = AABB{.min = glm::vec3(0.0f),
+                   .max = glm::vec3(static_cast<float>(width),
+                                    static_cast<float>(height), 0.0f)}
+                  .transformed(modelMatrix());
+
     reloadProjection(window);
   }
 
@@ -197,9 +168,11 @@ void main()
           glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(projection));
         },
         projection);
+    projection_ = projection;
   }
 
   void updateView(const glm::mat4 &view) {
+    visible_ = Frustum(projection_ * view).intersects(bounds_);
     shader_.use();
     shader_.setUniform(
         "view",
@@ -207,33 +180,36 @@ void main()
           glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(view));
         },
         view);
-    glm::mat4 model = glm::mat4(1.0f);
-    model =
-        glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    // model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f),
-    // glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f));
-
     shader_.setUniform(
         "model",
         [](GLint loc, const glm::mat4 &model) {
           glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(model));
         },
-        model);
+        modelMatrix());
   }
 
   void draw() {
+    GLState &state = GLState::getInstance();
+    state.countObjects(visible_ ? 1 : 0, visible_ ? 0 : 1);
+    if (!visible_) {
+      return;
+    }
     shader_.use();
     // bind our texture to texture unit 0 before drawing
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_);
+    state.bindTextureUnit(0, texture_);
 
     // draw our triangles
-    glBindVertexArray(VAO_);
+    state.bindVertexArray(VAO_);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    state.countDraw();
   }
 
   ~Texture() noexcept {
+    GLState &state = GLState::getInstance();
+    state.deleteTexture(texture_);
+    state.deleteVertexArray(VAO_);
+    state.deleteBuffer(VBO_);
+    state.deleteBuffer(EBO_);
     glDeleteTextures(1, &texture_);
     glDeleteVertexArrays(1, &VAO_);
     glDeleteBuffers(1, &VBO_);
@@ -243,7 +219,8 @@ void main()
   Texture &operator=(const Texture &) = delete;
   Texture(Texture &&t) noexcept
       : shader_(std::move(t.shader_)), texture_(t.texture_), VAO_(t.VAO_),
-        VBO_(t.VBO_), EBO_(t.EBO_) {
+        VBO_(t.VBO_), EBO_(t.EBO_), bounds_(t.bounds_),
+        projection_(t.projection_), visible_(t.visible_) {
     t.texture_ = 0;
     t.VAO_ = 0;
     t.VBO_ = 0;
@@ -256,6 +233,9 @@ void main()
       VAO_ = t.VAO_;
       VBO_ = t.VBO_;
       EBO_ = t.EBO_;
+      bounds_ = t.bounds_;
+      projection_ = t.projection_;
+      visible_ = t.visible_;
       t.texture_ = 0;
       t.VAO_ = 0;
       t.VBO_ = 0;
@@ -265,9 +245,119 @@ void main()
   }
 
 private:
+  static glm::mat4 modelMatrix() {
+    glm::mat4 model = glm::mat4(1.0f);
+    model =
+        glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    // model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f),
+    // glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::scale(model, glm::vec3(0.1f, 0.1f, 0.1f));
+  }
+
+  // GL 4.5 path: objects are created and filled by name, so nothing is bound
+  // and the global binding state is left as it was.
+  void createNamed(const std::array<float, 32> &vertices,
+                   const std::array<unsigned int, 6> &indices, int width,
+                   int height, GLenum format, GLint internalFormat,
+                   const unsigned char *data) {
+    glCreateBuffers(1, &VBO_);
+    glNamedBufferStorage(VBO_, sizeof(vertices), vertices.data(), 0);
+    glCreateBuffers(1, &EBO_);
+    glNamedBufferStorage(EBO_, sizeof(indices), indices.data(), 0);
+
+    glCreateVertexArrays(1, &VAO_);
+    glVertexArrayVertexBuffer(VAO_, 0, VBO_, 0, 8 * sizeof(float));
+    glVertexArrayElementBuffer(VAO_, EBO_);
+    // position, color and texture coord attributes
+    const std::array<std::pair<GLint, GLuint>, 3> attributes = {{
+        {3, 0},
+        {3, 3 * sizeof(float)},
+        {2, 6 * sizeof(float)},
+    }};
+    for (GLuint index = 0; index < attributes.size(); ++index) {
+      glEnableVertexArrayAttrib(VAO_, index);
+      glVertexArrayAttribFormat(VAO_, index, attributes[index].first,
+                                GL_FLOAT, GL_FALSE, attributes[index].second);
+      glVertexArrayAttribBinding(VAO_, index, 0);
+    }
+
+    GLsizei levels = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2) {
+      ++levels;
+    }
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture_);
+    glTextureParameteri(texture_, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+    glTextureParameteri(texture_, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+    glTextureParameteri(texture_, GL_TEXTURE_MIN_FILTER,
+                        GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(texture_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureStorage2D(texture_, levels, static_cast<GLenum>(internalFormat),
+                       width, height);
+    glTextureSubImage2D(texture_, 0, 0, 0, width, height, format,
+                        GL_UNSIGNED_BYTE, data);
+    glGenerateTextureMipmap(texture_);
+  }
+
+  // GL 3.3 path: bind-to-edit.
+  void createBound(const std::array<float, 32> &vertices,
+                   const std::array<unsigned int, 6> &indices, int width,
+                   int height, GLenum format, GLint internalFormat,
+                   const unsigned char *data) {
+    glGenVertexArrays(1, &VAO_);
+    glGenBuffers(1, &VBO_);
+    glGenBuffers(1, &EBO_);
+
+    GLState &state = GLState::getInstance();
+    state.bindVertexArray(VAO_);
+    state.bindBuffer(GL_ARRAY_BUFFER, VBO_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(),
+                 GL_STATIC_DRAW);
+
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices.data(),
+                 GL_STATIC_DRAW);
+
+    // position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
+                          static_cast<void *>(nullptr));
+    glEnableVertexAttribArray(0);
+    // color attribute
+    glVertexAttribPointer(
+        1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
+        reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
+            3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    // texture coord attribute
+    glVertexAttribPointer(
+        2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
+        reinterpret_cast<void *>( // NOLINT(performance-no-int-to-ptr)
+            6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    glGenTextures(1, &texture_);
+    state.bindTexture(GL_TEXTURE_2D,
+                      texture_); // all upcoming GL_TEXTURE_2D operations now
+                                 // have effect on this texture object
+    // set the texture wrapping parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                    GL_MIRRORED_REPEAT); // set texture wrapping to GL_REPEAT
+                                         // (default wrapping method)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+    // set texture filtering parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format,
+                 GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
+
   Shader shader_;
   unsigned int texture_ = 0;
   unsigned int VAO_ = 0;
   unsigned int VBO_ = 0;
   unsigned int EBO_ = 0;
+  AABB bounds_; // world space
+  glm::mat4 projection_ = glm::mat4(1.0f);
+  bool visible_ = true;
 };
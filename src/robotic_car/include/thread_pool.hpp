@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed set of worker threads for fork-join loops. parallelFor() hands out
+// task indices from a shared counter, so uneven tasks balance themselves,
+// and the calling thread works on the loop too instead of sleeping.
+class ThreadPool {
+public:
+  // `threadCount` includes the calling thread.
+  explicit ThreadPool(std::size_t threadCount = defaultThreadCount())
+      : threadCount_(std::max<std::size_t>(threadCount, 1)) {
+    workers_.reserve(threadCount_ - 1);
+    for (std::size_t i = 1; i < threadCount_; ++i) {
+      workers_.emplace_back([this] { work(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+  ThreadPool &operator=(ThreadPool &&) = delete;
+
+  std::size_t size() const { return threadCount_; }
+
+  static std::size_t defaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // Calls `task(i)` for every i in [0, count) and returns once all calls
+  // have finished. Not reentrant: `task` must not call parallelFor().
+  template <typename Task> void parallelFor(std::size_t count, Task &&task) {
+    if (count == 0) {
+      return;
+    }
+    if (workers_.empty() || count == 1) {
+      for (std::size_t i = 0; i < count; ++i) {
+        task(i);
+      }
+      return;
+    }
+
+    auto invoke = [](void *context, std::size_t i) {
+      (*static_cast<std::remove_reference_t<Task> *>(context))(i);
+    };
+    {
+      std::lock_guard lock(mutex_);
+      job_ = {.context = &task, .invoke = invoke, .count = count};
+      next_.store(0, std::memory_order_relaxed);
+      busy_ = workers_.size();
+      ++generation_;
+    }
+    wake_.notify_all();
+    run(job_);
+
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+  }
+
+private:
+  struct Job {
+    void *context = nullptr;
+    void (*invoke)(void *, std::size_t) = nullptr;
+    std::size_t count = 0;
+  };
+
+  void run(const Job &job) {
+    for (std::size_t i = next_.fetch_add(1, std::memory_order_relaxed);
+         i < job.count; i = next_.fetch_add(1, std::memory_order_relaxed)) {
+      job.invoke(job.context, i);
+    }
+  }
+
+  // Every worker takes part in every generation, even if the tasks have all
+  // been claimed by the time it wakes up, so parallelFor() only has to wait
+  // for `busy_` to reach zero.
+  void work() {
+    std::size_t seen = 0;
+    while (true) {
+      Job job;
+      {
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) {
+          return;
+        }
+        seen = generation_;
+        job = job_;
+      }
+      run(job);
+      {
+        std::lock_guard lock(mutex_);
+        if (--busy_ != 0) {
+          continue;
+        }
+      }
+      done_.notify_one();
+    }
+  }
+
+  std::size_t threadCount_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  Job job_;
+  std::atomic<std::size_t> next_{0};
+  std::size_t busy_ = 0;
+  std::size_t generation_ = 0;
+  bool stopping_ = false;
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Hierarchical timing wheel in simulated time. Time is a count of ticks
+// that only moves when advance() is called, typically once per simulation
+// step, so timers behave the same however fast the simulation runs. There
+// are no threads or locks; the owner of the wheel advances it.
+//
+// Each level is 64 slots, one per value of six bits of the expiry tick:
+// level 0 holds timers due within the current 64 ticks, level 1 those due
+// within the current 4096, and so on up to the full 64 bits. Starting and
+// cancelling a timer is O(1): it is linked into or out of one slot. A slot
+// of a higher level is only revisited when time reaches it, and then its
+// timers move down a level, so a timer is touched at most once per level
+// on its way to firing. A bitmap per level records which slots are in use,
+// which lets advance() jump straight to the next tick that has something
+// to do; idle timers cost nothing per tick, and an empty wheel advances in
+// constant time.
+class TimerWheel {
+public:
+  using Tick = std::uint64_t;
+  using Handle = std::uint32_t;
+
+  // Adds a timer, not running, and returns its handle. Timers live as long
+  // as the wheel.
+  Handle create() {
+    nodes_.push_back({});
+    return static_cast<Handle>(nodes_.size() - 1);
+  }
+
+  void reserve(std::size_t count) { nodes_.reserve(count); }
+  std::size_t size() const { return nodes_.size(); }
+
+  // (Re)starts `timer` to fire `delay` ticks from now; a delay of zero
+  // fires on the next tick.
+  void start(Handle timer, Tick delay) {
+    cancel(timer);
+    Node &node = nodes_[timer];
+    node.expiry = now_ + (delay == 0 ? 1 : delay);
+    node.running = true;
+    ++running_;
+    link(timer);
+  }
+
+  void cancel(Handle timer) {
+    Node &node = nodes_[timer];
+    if (!node.running) {
+      return;
+    }
+    unlink(timer);
+    node.running = false;
+    --running_;
+  }
+
+  bool isRunning(Handle timer) const { return nodes_[timer].running; }
+  std::size_t runningCount() const { return running_; }
+  Tick now() const { return now_; }
+
+  // Moves time forward by `ticks` and calls `onExpire(handle)` for every
+  // timer that fires, in order of expiry. `onExpire` may start or cancel
+  // timers; those it starts fire on a later tick.
+  template <typename OnExpire> void advance(Tick ticks, OnExpire &&onExpire) {
+    Tick target = now_ + ticks;
+    while (running_ != 0) {
+      Tick next = nextEvent();
+      if (next > target) {
+        break;
+      }
+      now_ = next;
+      cascade();
+      fire(onExpire);
+    }
+    now_ = target;
+  }
+
+private:
+  static constexpr int slotBits = 6;
+  static constexpr std::size_t slots = std::size_t{1} << slotBits;
+  static constexpr int levels =
+      (std::numeric_limits<Tick>::digits + slotBits - 1) / slotBits;
+  static constexpr Handle none = std::numeric_limits<Handle>::max();
+
+  struct Node {
+    Tick expiry = 0;
+    Handle previous = none;
+    Handle next = none;
+    std::uint16_t slot = 0; // level * slots + slot within the level
+    bool running = false;
+  };
+
+  static int digit(Tick tick, int level) {
+    return static_cast<int>((tick >> (level * slotBits)) & (slots - 1));
+  }
+
+  // The slot for `expiry`: the highest level at which it differs from now.
+  std::uint16_t slotFor(Tick expiry) const {
+    int level = expiry == now_
+                    ? 0
+                    : (std::bit_width(expiry ^ now_) - 1) / slotBits;
+    return static_cast<std::uint16_t>(level * slots + digit(expiry, level));
+  }
+
+  void link(Handle timer) {
+    Node &node = nodes_[timer];
+    node.slot = slotFor(node.expiry);
+    node.previous = none;
+    node.next = heads_[node.slot];
+    if (node.next != none) {
+      nodes_[node.next].previous = timer;
+    }
+    heads_[node.slot] = timer;
+    occupied_[node.slot / slots] |= std::uint64_t{1} << (node.slot % slots);
+  }
+
+  void unlink(Handle timer) {
+    Node &node = nodes_[timer];
+    if (node.previous != none) {
+      nodes_[node.previous].next = node.next;
+    } else {
+      heads_[node.slot] = node.next;
+    }
+    if (node.next != none) {
+      nodes_[node.next].previous = node.previous;
+    }
+    if (heads_[node.slot] == none) {
+      occupied_[node.slot / slots] &=
+          ~(std::uint64_t{1} << (node.slot % slots));
+    }
+  }
+
+  // The first tick after now at which a slot fires or must move down a
+  // level. Every occupied slot is ahead of now's digit at its level.
+  Tick nextEvent() const {
+    Tick next = std::numeric_limits<Tick>::max();
+    for (int level = 0; level < levels; ++level) {
+      int current = digit(now_, level);
+      std::uint64_t ahead =
+          current + 1 < static_cast<int>(slots)
+              ? occupied_[level] & (~std::uint64_t{0} << (current + 1))
+              : 0;
+      if (ahead == 0) {
+        continue;
+      }
+      int shift = level * slotBits;
+      Tick span = shift + slotBits < std::numeric_limits<Tick>::digits
+                      ? Tick{1} << (shift + slotBits)
+                      : 0;
+      Tick base = span == 0 ? 0 : now_ & ~(span - 1);
+      next = std::min(next,
+                      base | (static_cast<Tick>(std::countr_zero(ahead))
+                              << shift));
+    }
+    return next;
+  }
+
+  // Moves the timers of every slot that now has reached down to the level
+  // their expiry now calls for, highest level first.
+  void cascade() {
+    for (int level = levels - 1; level > 0; --level) {
+      Tick below = (Tick{1} << (level * slotBits)) - 1;
+      if ((now_ & below) != 0) {
+        continue;
+      }
+      auto slot = static_cast<std::uint16_t>(level * slots +
+                                             digit(now_, level));
+      Handle timer = heads_[slot];
+      heads_[slot] = none;
+      occupied_[level] &= ~(std::uint64_t{1} << (slot % slots));
+      while (timer != none) {
+        Handle next = nodes_[timer].next;
+        link(timer);
+        timer = next;
+      }
+    }
+  }
+
+  template <typename OnExpire> void fire(OnExpire &onExpire) {
+    auto slot = static_cast<std::uint16_t>(digit(now_, 0));
+    while (heads_[slot] != none) {
+      Handle timer = heads_[slot];
+      unlink(timer);
+      nodes_[timer].running = false;
+      --running_;
+      onExpire(timer);
+    }
+  }
+
+  std::vector<Node> nodes_;
+  std::array<Handle, levels * slots> heads_ = filledHeads();
+  std::array<std::uint64_t, levels> occupied_{};
+  std::size_t running_ = 0;
+  Tick now_ = 0;
+
+  static constexpr std::array<Handle, levels * slots> filledHeads() {
+    std::array<Handle, levels * slots> heads{};
+    heads.fill(none);
+    return heads;
+  }
+};
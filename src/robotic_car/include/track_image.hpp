@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include <stb_image.h>
+#endif
+
+// A decoded track image, bottom row first like the GL texture drawn from
+// the same file. Everything the simulation derives from the track is built
+// from this and then the pixels are freed.
+struct TrackImage {
+  struct Deleter {
+    void operator()(unsigned char *data) const { stbi_image_free(data); }
+  };
+
+  std::unique_ptr<unsigned char, Deleter> pixels;
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+};
+
+inline TrackImage loadTrackImage(std::string_view path) {
+  stbi_set_flip_vertically_on_load(true);
+  if (path.empty()) {
+    throw std::runtime_error("Texture image path is empty");
+  }
+  TrackImage image;
+  image.pixels.reset(stbi_load(std::string(path).c_str(), &image.width,
+                               &image.height, &image.channels, 0));
+  if (!image.pixels) {
+    throw std::runtime_error("Failed to load texture image");
+  }
+  return image;
+}
@@ -0,0 +1,506 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "car_simulation.hpp"
+#include "mapped_file.hpp"
+
+// A car's state after one simulation step, as the trajectory log keeps it.
+struct TrajectoryStep {
+  glm::vec3 position = glm::vec3(0.0f);
+  glm::vec3 direction = {0.0f, 0.0f, 1.0f}; // unit length, in the xz plane
+  std::uint8_t sensorBits = 0;              // bit i: sensor i + 1 saw black
+  CarAction action = CarAction::Forward;
+
+  static TrajectoryStep of(const RoboticCar &car) {
+    CarState state = car.state();
+    return {.position = state.position,
+            .direction = state.direction,
+            .sensorBits = static_cast<std::uint8_t>(car.sensorBits()),
+            .action = car.action()};
+  }
+
+  CarState toState() const {
+    CarState state = {.position = position,
+                      .direction = direction,
+                      .sensors = RoboticCar::defaultSensors()};
+    for (std::size_t i = 0; i < state.sensors.size(); ++i) {
+      bool black = ((sensorBits >> i) & 1) != 0;
+      state.sensors[i].color = black ? CarColor::Blue : CarColor::Green;
+    }
+    return state;
+  }
+};
+
+// The on-disk layout shared by TrajectoryRecorder and TrajectoryLog.
+//
+// A 32-byte header is followed by chunks of up to stepsPerChunk steps, then
+// an index of where every chunk starts and a trailer that points at the
+// index. A chunk is a 16-byte header (first step, step count, payload size)
+// and a payload that starts from scratch, so any chunk decodes on its own.
+//
+// Positions are stored in fixed point, 1/4096 of a unit (1/400 of a track
+// pixel), and the x and z of the direction in units of 2^-20. Each step is
+// one byte of sensor bits and action, then for each of those five integers
+// the change in its change since the step before, zigzagged and written as
+// a LEB128 varint. A car driving straight or turning steadily has second
+// differences at or near zero, so most steps take six to eight bytes.
+//
+// The recorder flushes every chunk as it is written. A log cut short by a
+// crash has no index; TrajectoryLog then rebuilds it from the chunk headers
+// and drops a trailing chunk that was only partly written.
+namespace trajectory_format {
+
+inline constexpr std::array<char, 8> fileMagic = {'C', 'A', 'R', 'T',
+                                                  'R', 'A', 'C', 'E'};
+inline constexpr std::array<char, 8> indexMagic = {'C', 'A', 'R', 'I',
+                                                   'N', 'D', 'E', 'X'};
+inline constexpr std::uint32_t version = 1;
+inline constexpr std::uint32_t stepsPerChunk = 4096;
+inline constexpr double positionScale = 4096.0;
+inline constexpr double directionScale = 1 << 20;
+inline constexpr std::size_t values = 5; // x, y, z, direction x, z
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t stepsPerChunk;
+  double stepSeconds;
+  std::uint64_t reserved = 0;
+};
+static_assert(sizeof(FileHeader) == 32);
+
+struct ChunkHeader {
+  std::uint64_t firstStep;
+  std::uint32_t stepCount;
+  std::uint32_t payloadBytes;
+};
+static_assert(sizeof(ChunkHeader) == 16);
+
+struct IndexEntry {
+  std::uint64_t firstStep;
+  std::uint64_t offset; // of the chunk header, from the start of the file
+};
+
+struct Trailer {
+  std::uint64_t indexOffset;
+  std::uint64_t chunkCount;
+  std::array<char, 8> magic;
+};
+static_assert(sizeof(Trailer) == 24);
+
+inline std::array<std::int64_t, values> quantize(const TrajectoryStep &step) {
+  auto fixed = [](float value, double scale) {
+    return static_cast<std::int64_t>(std::llround(value * scale));
+  };
+  return {fixed(step.position.x, positionScale),
+          fixed(step.position.y, positionScale),
+          fixed(step.position.z, positionScale),
+          fixed(step.direction.x, directionScale),
+          fixed(step.direction.z, directionScale)};
+}
+
+inline std::uint64_t zigzag(std::int64_t value) {
+  return (static_cast<std::uint64_t>(value) << 1) ^
+         static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value) {
+  return static_cast<std::int64_t>(value >> 1) ^
+         -static_cast<std::int64_t>(value & 1);
+}
+
+// Carries the previous value and change of each quantity across the steps
+// of one chunk. The first step's residual is its value.
+struct Predictor {
+  std::array<std::int64_t, values> previous{};
+  std::array<std::int64_t, values> change{};
+  bool started = false;
+
+  // The residual stored for `value`, and the predictor moved past it.
+  std::int64_t residual(std::size_t i, std::int64_t value) {
+    std::int64_t newChange = started ? value - previous[i] : 0;
+    std::int64_t result = started ? newChange - change[i] : value;
+    previous[i] = value;
+    change[i] = newChange;
+    return result;
+  }
+
+  // The inverse of residual().
+  std::int64_t value(std::size_t i, std::int64_t residual) {
+    std::int64_t result =
+        started ? previous[i] + change[i] + residual : residual;
+    change[i] = started ? result - previous[i] : 0;
+    previous[i] = result;
+    return result;
+  }
+};
+
+inline void appendVarint(std::vector<std::uint8_t> &out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+} // namespace trajectory_format
+
+// Streams a car's steps to a trajectory log. record() only copies the step
+// into a buffer that the simulation thread owns; a full buffer of one
+// chunk is handed to a writer thread that encodes and writes it, so the
+// simulation never waits for the disk. Buffers go back and forth between
+// the two threads and are reused, and only a writer that falls more than
+// a chunk behind makes record() allocate another.
+class TrajectoryRecorder {
+public:
+  TrajectoryRecorder(const std::string &path, double stepSeconds)
+      : file_(path, std::ios::binary | std::ios::trunc) {
+    using namespace trajectory_format;
+    if (!file_) {
+      throw std::runtime_error("Failed to create trajectory log " + path);
+    }
+    FileHeader header{.magic = fileMagic,
+                      .version = version,
+                      .stepsPerChunk = stepsPerChunk,
+                      .stepSeconds = stepSeconds};
+    write(&header, sizeof(header));
+    filling_.reserve(stepsPerChunk);
+    spare_.emplace_back().reserve(stepsPerChunk);
+    writer_ = std::thread([this] { writeChunks(); });
+  }
+
+  ~TrajectoryRecorder() { close(); }
+  TrajectoryRecorder(const TrajectoryRecorder &) = delete;
+  TrajectoryRecorder &operator=(const TrajectoryRecorder &) = delete;
+  TrajectoryRecorder(TrajectoryRecorder &&) = delete;
+  TrajectoryRecorder &operator=(TrajectoryRecorder &&) = delete;
+
+  // Simulation thread only.
+  void record(const TrajectoryStep &step) {
+    filling_.push_back(step);
+    if (filling_.size() == trajectory_format::stepsPerChunk) {
+      handOff();
+    }
+  }
+
+  // Writes the steps recorded so far, the index and the trailer, and stops
+  // the writer. Call it from the simulation thread, or after that has
+  // stopped; record() must not be called afterwards.
+  void close() {
+    if (!writer_.joinable()) {
+      return;
+    }
+    if (!filling_.empty()) {
+      handOff();
+    }
+    {
+      std::lock_guard lock(mutex_);
+      closing_ = true;
+    }
+    wake_.notify_one();
+    writer_.join();
+    writeIndex();
+  }
+
+  // Writer side, final once close() has returned.
+  std::uint64_t bytesWritten() const { return offset_; }
+  std::uint64_t stepsWritten() const { return stepsWritten_; }
+
+private:
+  void handOff() {
+    std::vector<TrajectoryStep> next;
+    {
+      std::lock_guard lock(mutex_);
+      full_.push_back(std::move(filling_));
+      if (!spare_.empty()) {
+        next = std::move(spare_.back());
+        spare_.pop_back();
+      }
+    }
+    wake_.notify_one();
+    next.reserve(trajectory_format::stepsPerChunk);
+    filling_ = std::move(next);
+  }
+
+  void writeChunks() {
+    std::vector<std::uint8_t> payload;
+    while (true) {
+      std::vector<TrajectoryStep> steps;
+      {
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] { return closing_ || !full_.empty(); });
+        if (full_.empty()) {
+          return;
+        }
+        steps = std::move(full_.front());
+        full_.pop_front();
+      }
+      encode(steps, payload);
+      trajectory_format::ChunkHeader header{
+          .firstStep = stepsWritten_,
+          .stepCount = static_cast<std::uint32_t>(steps.size()),
+          .payloadBytes = static_cast<std::uint32_t>(payload.size())};
+      index_.push_back({.firstStep = stepsWritten_, .offset = offset_});
+      write(&header, sizeof(header));
+      write(payload.data(), payload.size());
+      file_.flush();
+      stepsWritten_ += steps.size();
+
+      steps.clear();
+      std::lock_guard lock(mutex_);
+      spare_.push_back(std::move(steps));
+    }
+  }
+
+  static void encode(const std::vector<TrajectoryStep> &steps,
+                     std::vector<std::uint8_t> &out) {
+    using namespace trajectory_format;
+    out.clear();
+    Predictor predictor;
+    for (const TrajectoryStep &step : steps) {
+      out.push_back(static_cast<std::uint8_t>(
+          (step.sensorBits & 0x3fu) |
+          (static_cast<unsigned>(step.action) << 6)));
+      std::array<std::int64_t, values> quantized = quantize(step);
+      for (std::size_t i = 0; i < values; ++i) {
+        appendVarint(out, zigzag(predictor.residual(i, quantized[i])));
+      }
+      predictor.started = true;
+    }
+  }
+
+  void writeIndex() {
+    using namespace trajectory_format;
+    Trailer trailer{.indexOffset = offset_,
+                    .chunkCount = index_.size(),
+                    .magic = indexMagic};
+    write(index_.data(), index_.size() * sizeof(IndexEntry));
+    write(&trailer, sizeof(trailer));
+    file_.flush();
+  }
+
+  void write(const void *data, std::size_t size) {
+    file_.write(static_cast<const char *>(data),
+                static_cast<std::streamsize>(size));
+    offset_ += size;
+  }
+
+  // Simulation side.
+  std::vector<TrajectoryStep> filling_;
+
+  // Shared, under mutex_.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::vector<TrajectoryStep>> full_;
+  std::vector<std::vector<TrajectoryStep>> spare_;
+  bool closing_ = false;
+
+  // Writer side.
+  std::ofstream file_;
+  std::uint64_t offset_ = 0;
+  std::uint64_t stepsWritten_ = 0;
+  std::vector<trajectory_format::IndexEntry> index_;
+  std::thread writer_;
+};
+
+// A trajectory log mapped into memory for replay. Finding the chunk that
+// holds a step is a binary search of the index; the chunk is then decoded
+// once and kept, so playing forward decodes each chunk only once.
+class TrajectoryLog {
+public:
+  explicit TrajectoryLog(const std::string &path) : file_(path) {
+    using namespace trajectory_format;
+    std::span<const std::byte> bytes = file_.bytes();
+    FileHeader header;
+    if (bytes.size() < sizeof(header)) {
+      throw std::runtime_error("Not a trajectory log: " + path);
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != fileMagic || header.version != version ||
+        !(header.stepSeconds > 0.0)) {
+      throw std::runtime_error("Not a trajectory log: " + path);
+    }
+    stepSeconds_ = header.stepSeconds;
+    if (!readIndex()) {
+      rebuildIndex();
+    }
+  }
+
+  std::uint64_t stepCount() const { return stepCount_; }
+  double stepSeconds() const { return stepSeconds_; }
+  double duration() const {
+    return static_cast<double>(stepCount_) * stepSeconds_;
+  }
+
+  // Step `step`, which must be below stepCount().
+  const TrajectoryStep &at(std::uint64_t step) {
+    if (step < decodedFirst_ || step >= decodedFirst_ + decoded_.size()) {
+      decodeChunkOf(step);
+    }
+    return decoded_[step - decodedFirst_];
+  }
+
+  // The car `seconds` into the run, blended between the steps either side
+  // the way Simulation::sample() blends, and clamped to the recording.
+  CarState stateAt(double seconds) {
+    if (stepCount_ == 0) {
+      return TrajectoryStep{}.toState();
+    }
+    double position =
+        std::clamp(seconds / stepSeconds_, 0.0,
+                   static_cast<double>(stepCount_ - 1));
+    auto step = static_cast<std::uint64_t>(position);
+    CarState current = at(step).toState();
+    if (step + 1 >= stepCount_) {
+      return current;
+    }
+    CarState next = at(step + 1).toState();
+    auto alpha = static_cast<float>(position - static_cast<double>(step));
+    return CarState::interpolate(current, next, alpha);
+  }
+
+private:
+  // Uses the index the recorder wrote on close(), if there is one.
+  bool readIndex() {
+    using namespace trajectory_format;
+    std::span<const std::byte> bytes = file_.bytes();
+    Trailer trailer;
+    if (bytes.size() < sizeof(FileHeader) + sizeof(trailer)) {
+      return false;
+    }
+    std::memcpy(&trailer, bytes.data() + bytes.size() - sizeof(trailer),
+                sizeof(trailer));
+    std::uint64_t indexEnd = bytes.size() - sizeof(trailer);
+    if (trailer.magic != indexMagic || trailer.indexOffset > indexEnd ||
+        (indexEnd - trailer.indexOffset) / sizeof(IndexEntry) !=
+            trailer.chunkCount) {
+      return false;
+    }
+    index_.resize(trailer.chunkCount);
+    if (!index_.empty()) {
+      std::memcpy(index_.data(), bytes.data() + trailer.indexOffset,
+                  index_.size() * sizeof(IndexEntry));
+    }
+    dataEnd_ = trailer.indexOffset;
+    stepCount_ = 0;
+    if (!index_.empty()) {
+      ChunkHeader last = chunkHeader(index_.back().offset);
+      stepCount_ = index_.back().firstStep + last.stepCount;
+    }
+    return true;
+  }
+
+  // Walks the chunk headers of a log that was never closed, stopping at the
+  // first chunk that does not fit in the file.
+  void rebuildIndex() {
+    using namespace trajectory_format;
+    index_.clear();
+    stepCount_ = 0;
+    dataEnd_ = file_.bytes().size();
+    std::uint64_t offset = sizeof(FileHeader);
+    while (offset + sizeof(ChunkHeader) <= dataEnd_) {
+      ChunkHeader header = chunkHeader(offset);
+      std::uint64_t end = offset + sizeof(header) + header.payloadBytes;
+      if (end > dataEnd_ || header.firstStep != stepCount_) {
+        break;
+      }
+      index_.push_back({.firstStep = header.firstStep, .offset = offset});
+      stepCount_ += header.stepCount;
+      offset = end;
+    }
+    dataEnd_ = offset;
+  }
+
+  trajectory_format::ChunkHeader chunkHeader(std::uint64_t offset) const {
+    trajectory_format::ChunkHeader header;
+    std::memcpy(&header, file_.bytes().data() + offset, sizeof(header));
+    return header;
+  }
+
+  void decodeChunkOf(std::uint64_t step) {
+    using namespace trajectory_format;
+    if (step >= stepCount_) {
+      throw std::out_of_range("Step past the end of the trajectory log");
+    }
+    auto chunk = std::upper_bound(index_.begin(), index_.end(), step,
+                                  [](std::uint64_t value,
+                                     const IndexEntry &entry) {
+                                    return value < entry.firstStep;
+                                  }) -
+                 1;
+    ChunkHeader header = chunkHeader(chunk->offset);
+    std::uint64_t begin = chunk->offset + sizeof(header);
+    if (begin + header.payloadBytes > dataEnd_) {
+      throw std::runtime_error("Trajectory log chunk runs past its end");
+    }
+    const auto *in =
+        reinterpret_cast<const std::uint8_t *>(file_.bytes().data()) + begin;
+    const std::uint8_t *end = in + header.payloadBytes;
+    auto readVarint = [&in, end] {
+      std::uint64_t value = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        if (in == end) {
+          break;
+        }
+        std::uint8_t byte = *in++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+          return value;
+        }
+      }
+      throw std::runtime_error("Corrupt varint in trajectory log");
+    };
+
+    decoded_.resize(header.stepCount);
+    decodedFirst_ = header.firstStep;
+    Predictor predictor;
+    for (TrajectoryStep &out : decoded_) {
+      if (in == end) {
+        throw std::runtime_error("Trajectory log chunk ends early");
+      }
+      std::uint8_t flags = *in++;
+      std::array<std::int64_t, values> quantized{};
+      for (std::size_t i = 0; i < values; ++i) {
+        quantized[i] = predictor.value(i, unzigzag(readVarint()));
+      }
+      predictor.started = true;
+      auto unfixed = [](std::int64_t value, double scale) {
+        return static_cast<float>(static_cast<double>(value) / scale);
+      };
+      out = {.position = {unfixed(quantized[0], positionScale),
+                          unfixed(quantized[1], positionScale),
+                          unfixed(quantized[2], positionScale)},
+             .direction = {unfixed(quantized[3], directionScale), 0.0f,
+                           unfixed(quantized[4], directionScale)},
+             .sensorBits = static_cast<std::uint8_t>(flags & 0x3fu),
+             .action = static_cast<CarAction>(flags >> 6)};
+    }
+  }
+
+  MappedFile file_;
+  double stepSeconds_ = 0.0;
+  std::uint64_t stepCount_ = 0;
+  std::uint64_t dataEnd_ = 0;
+  std::vector<trajectory_format::IndexEntry> index_;
+  // The last chunk decoded, starting at step decodedFirst_.
+  std::vector<TrajectoryStep> decoded_;
+  std::uint64_t decodedFirst_ = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread
+// without either ever waiting. The writer fills back() and publish()es it;
+// the reader calls update() and then reads front(). Three slots mean the
+// writer always has one to itself, the reader has another, and the third
+// holds the newest published value. A slot is swapped with a single atomic
+// exchange, so nothing is copied and old values are silently skipped when
+// the writer is faster than the reader.
+template <typename T> class TripleBuffer {
+public:
+  TripleBuffer() = default;
+  explicit TripleBuffer(const T &initial) {
+    for (Slot &slot : slots_) {
+      slot.value = initial;
+    }
+  }
+
+  ~TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+  TripleBuffer(TripleBuffer &&) = delete;
+  TripleBuffer &operator=(TripleBuffer &&) = delete;
+
+  // Writer side.
+  T &back() { return slots_[back_].value; }
+
+  // Writer side. Makes back() the newest value and hands the writer a
+  // different slot, which still holds an older value.
+  void publish() {
+    std::uint8_t previous =
+        middle_.exchange(back_ | freshBit, std::memory_order_acq_rel);
+    back_ = previous & indexMask;
+  }
+
+  // Reader side. Moves the newest value to front() if there is one that has
+  // not been read yet, and says whether there was.
+  bool update() {
+    if ((middle_.load(std::memory_order_relaxed) & freshBit) == 0) {
+      return false;
+    }
+    std::uint8_t previous = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & indexMask;
+    return true;
+  }
+
+  // Reader side.
+  const T &front() const { return slots_[front_].value; }
+
+private:
+  static constexpr std::uint8_t indexMask = 0x3;
+  static constexpr std::uint8_t freshBit = 0x4;
+
+  // Each slot on its own cache line, so the two threads do not share one.
+  struct alignas(64) Slot {
+    T value{};
+  };
+
+  std::array<Slot, 3> slots_;
+  alignas(64) std::atomic<std::uint8_t> middle_{1};
+  alignas(64) std::uint8_t back_ = 2;
+  alignas(64) std::uint8_t front_ = 0;
+};
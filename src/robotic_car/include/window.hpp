@@ -10,6 +10,9 @@
 #include <glm/glm.hpp>
 
 #include "camera.hpp"
+#include "debug_output.hpp"
+#include "gl_capabilities.hpp"
+#include "gl_state.hpp"
 #include "keyboard.hpp"
 
 class Window {
@@ -30,7 +33,11 @@ public:
     return instance;
   }
 
-  void initialize(int width, int height, std::string_view title) {
+  // With `debugContext`, the context is created with the debug flag and
+  // driver messages are collected by DebugOutput and printed as they first
+  // appear.
+  void initialize(int width, int height, std::string_view title,
+                  bool debugContext = false) {
     width_ = width;
     height_ = height;
     title_ = title;
@@ -41,6 +48,8 @@ public:
     }
 
     /* Create a windowed mode window and its OpenGL context */
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT,
+                   debugContext ? GLFW_TRUE : GLFW_FALSE);
     window_ = glfwCreateWindow(width_, height_, title_.c_str(), NULL, NULL);
     if (!window_) {
       glfwTerminate();
@@ -88,20 +97,28 @@ public:
     if (glewInit() != GLEW_OK) {
       throw std::runtime_error("GLEW init error");
     }
+    GLCapabilities::getInstance().detect();
+    if (debugContext) {
+      DebugOutput::getInstance().install();
+    }
   }
 
   template <typename Func, typename... Args,
             std::enable_if_t<
                 std::is_invocable_v<Func, float, glm::mat4, Args...>, int> = 0>
   void run(Func &&func, Args &&...args) {
-    float lastFrame = (float)glfwGetTime();
+    // Seconds since glfwInit() as a double; a float loses whole
+    // milliseconds after a few hours.
+    double lastFrame = glfwGetTime();
     while (!glfwWindowShouldClose(window_)) {
+      GLState::getInstance().beginFrame();
+
       /* Render here */
       glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-      float time = (float)glfwGetTime();
-      float deltaTime = time - lastFrame;
+      double time = glfwGetTime();
+      auto deltaTime = static_cast<float>(time - lastFrame);
       lastFrame = time;
       processKeyboardInput(window_, deltaTime, camera_);
 
@@ -112,6 +129,8 @@ public:
       /* Swap front and back buffers */
       glfwSwapBuffers(window_);
 
+      DebugOutput::getInstance().drain();
+
       /* Poll for and process events */
       glfwPollEvents();
     }
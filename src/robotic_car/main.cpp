@@ -1,22 +1,148 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
+#include <optional>
 #include <iostream>
 #include <memory>
+#include <print>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "command_buffer.hpp"
+#include "debug_output.hpp"
+#include "gl_state.hpp"
+#include "job_system.hpp"
+#include "render_queue.hpp"
 #include "robotic_car.hpp"
+#include "simulation.hpp"
+#include "task_graph.hpp"
 #include "texture.hpp"
+#include "thread_pool.hpp"
+#include "trajectory_log.hpp"
 #include "window.hpp"
 
 constexpr unsigned int SCR_WIDTH = 1280;
 constexpr unsigned int SCR_HEIGHT = 720;
 
-int main() {
+// Draws 1, 100 and 10000 cars on a grid with a draw call per cube, with one
+// instanced draw, through a RenderQueue, and recorded into command buffers on
+// every core, and prints draw calls and average time per frame for each.
+static void benchmarkInstancing(Window &window, CarModel &carModel,
+                                RenderQueue &queue) {
+  constexpr int frames = 200;
+  constexpr std::array<int, 3> carCounts = {1, 100, 10000};
+  const CarModel::Sensor sensor = {.relative_position = {0.0f, 0.0f, 2.0f},
+                                   .color = CarModel::Color::Blue,
+                                   .scale = 0.1f};
+  enum class Mode : std::uint8_t { PerCube, Instanced, Queued, Recorded };
+  constexpr std::array<std::string_view, 4> modeNames = {
+      "per cube", "instanced", "queued", "recorded"};
+  constexpr std::array<Mode, 4> modes = {Mode::PerCube, Mode::Instanced,
+                                         Mode::Queued, Mode::Recorded};
+  ThreadPool pool;
+  ParallelRecorder recorder(pool);
+  std::println("Recording on {} threads", pool.size());
+
+  glfwSwapInterval(0);
+  GLState &state = GLState::getInstance();
+  carModel.updateView(window.getCamera().getViewMatrix());
+  for (int cars : carCounts) {
+    auto side = static_cast<std::size_t>(std::ceil(std::sqrt(cars)));
+    auto positionOf = [side](std::size_t i) {
+      return glm::vec3(static_cast<float>(i % side) * 4.0f, 1.5f,
+                       static_cast<float>(i / side) * 4.0f);
+    };
+    for (Mode mode : modes) {
+      auto start = std::chrono::steady_clock::now();
+      for (int frame = 0; frame < frames; ++frame) {
+        state.beginFrame();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (mode == Mode::Recorded) {
+          recorder.record(cars, [&](CommandBuffer &commands,
+                                    std::size_t begin, std::size_t end) {
+            thread_local std::vector<InstanceData> cubes;
+            cubes.clear();
+            for (std::size_t i = begin; i < end; ++i) {
+              CarModel::appendCar(cubes, positionOf(i), {0.0f, 0.0f, 1.0f},
+                                  sensor, sensor, sensor, sensor, sensor,
+                                  sensor);
+            }
+            carModel.record(commands, cubes);
+          });
+          recorder.replay();
+        } else {
+          for (std::size_t i = 0; i < static_cast<std::size_t>(cars); ++i) {
+            carModel.add(positionOf(i), {0.0f, 0.0f, 1.0f}, sensor, sensor,
+                         sensor, sensor, sensor, sensor);
+          }
+        }
+        switch (mode) {
+        case Mode::PerCube:
+          carModel.flush(CarModel::Submission::PerCube);
+          break;
+        case Mode::Instanced:
+          carModel.flush(CarModel::Submission::Instanced);
+          break;
+        case Mode::Queued:
+          carModel.flush(queue);
+          queue.submit();
+          break;
+        case Mode::Recorded:
+          break;
+        }
+        glfwSwapBuffers(window.getGLFWwindow());
+        glfwPollEvents();
+      }
+      glFinish();
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      state.beginFrame();
+      std::println("{:>6} cars, {:<9}: {:>6} draw calls, {:8.3f} ms per frame",
+                   cars, modeNames[static_cast<std::size_t>(mode)],
+                   state.getFrameStatistics().draws, elapsed.count() / frames);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bool debugContext = false;
+  bool benchmark = false;
+  bool inlineSimulation = false;
+  std::string tracePath;
+  std::string recordPath;
+  std::string replayPath;
+  double replayFrom = 0.0;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string_view(argv[i]) == "--gl-debug") {
+      debugContext = true;
+    } else if (std::string_view(argv[i]) == "--bench-instancing") {
+      benchmark = true;
+    } else if (std::string_view(argv[i]) == "--sim-inline") {
+      inlineSimulation = true;
+    } else if (std::string_view(argv[i]) == "--trace-frames" &&
+               i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (std::string_view(argv[i]) == "--record" && i + 1 < argc) {
+      recordPath = argv[++i];
+    } else if (std::string_view(argv[i]) == "--replay" && i + 1 < argc) {
+      replayPath = argv[++i];
+    } else if (std::string_view(argv[i]) == "--replay-from" &&
+               i + 1 < argc) {
+      replayFrom = std::stod(argv[++i]);
+    }
+  }
+
   Window &window = Window::getInstance();
-  window.initialize(SCR_WIDTH, SCR_HEIGHT, "Robotic Car Simulation");
+  window.initialize(SCR_WIDTH, SCR_HEIGHT, "Robotic Car Simulation",
+                    debugContext);
 
   Texture texture(window, "line.jpg");
   MyMesh mesh;
@@ -27,18 +153,147 @@ int main() {
       return 0;
     }
   }
-  RoboticCar car(window, mesh, "line.jpg");
+  // Enough for the largest --bench-instancing fleet, seven cubes per car.
+  constexpr std::size_t maxCubes = 10000 * 7;
+  CarModel carModel(window, mesh, maxCubes);
+  RenderQueue queue(maxCubes);
+  if (benchmark) {
+    benchmarkInstancing(window, carModel, queue);
+    return 0;
+  }
+
+  RoboticCar car("line.jpg");
   car.setPosition({16.5f, 1.51f, 20.0f});
   glm::vec3 direction = {0.0f, 0.0f, 0.5f};
   car.setDirection(direction);
 
+  // The car is simulated in fixed steps on its own thread, or on this one
+  // before each frame with --sim-inline; frames only sample it.
+  Simulation simulation(car);
+  std::optional<TrajectoryRecorder> recorder;
+  if (!recordPath.empty() && replayPath.empty()) {
+    recorder.emplace(
+        recordPath,
+        std::chrono::duration<double>(simulation.step()).count());
+    simulation.setRecorder(&*recorder);
+  }
+
+  // --replay draws a recorded run instead of simulating one, starting
+  // --replay-from seconds in; the left and right arrow keys jump back and
+  // forward ten seconds.
+  std::optional<TrajectoryLog> replay;
+  double replayTime = replayFrom;
+  if (!replayPath.empty()) {
+    replay.emplace(replayPath);
+    std::println("Replaying {} steps ({:.1f} s) from {}", replay->stepCount(),
+                 replay->duration(), replayPath);
+  }
+
+  // The frame as a task graph: sampling the car and recording its commands
+  // run on workers, alongside the track's view update on this thread, and
+  // everything meets again in the GL submission.
+  JobSystem jobs;
+  TaskGraph frame;
+  glm::mat4 frameView = glm::mat4(1.0f);
+  CarState carSample;
+  std::vector<InstanceData> carCubes;
+  CommandBuffer carCommands;
+  {
+    using enum TaskGraph::Affinity;
+    TaskGraph::Resource camera = frame.resource("camera");
+    TaskGraph::Resource carState = frame.resource("car");
+    TaskGraph::Resource track = frame.resource("track");
+    TaskGraph::Resource commands = frame.resource("car commands");
+    frame.add("sample car", {}, {carState}, [&] {
+      carSample = replay ? replay->stateAt(replayTime)
+                         : simulation.sample(Simulation::Clock::now());
+    });
+    frame.add("camera", {}, {camera},
+              [&] { carModel.updateView(frameView); });
+    frame.add(
+        "track view", {}, {track}, [&] { texture.updateView(frameView); },
+        Owner);
+    frame.add("record car", {carState, camera}, {commands}, [&] {
+      carCubes.clear();
+      carCommands.clear();
+      CarModel::appendCar(carCubes, carSample);
+      carModel.record(carCommands, carCubes);
+    });
+    frame.add(
+        "submit", {track, commands}, {},
+        [&] {
+          {
+            DebugGroup group("track");
+            texture.draw();
+          }
+          DebugGroup group("car");
+          carCommands.replay();
+        },
+        Owner);
+  }
+  TaskGraphTrace trace;
+
+  if (!inlineSimulation && !replay) {
+    simulation.start();
+  }
+  std::array<bool, 2> seekKeysDown{};
   window.run([&](float deltaTime, glm::mat4 view) {
-    texture.updateView(view);
-    texture.draw();
-    car.update(deltaTime);
-    car.updateView(view);
-    car.draw();
+    if (replay) {
+      constexpr std::array<int, 2> seekKeys = {GLFW_KEY_LEFT, GLFW_KEY_RIGHT};
+      constexpr double seekSeconds = 10.0;
+      replayTime += deltaTime;
+      for (std::size_t i = 0; i < seekKeys.size(); ++i) {
+        bool down = glfwGetKey(window.getGLFWwindow(), seekKeys[i]) ==
+                    GLFW_PRESS;
+        if (down && !seekKeysDown[i]) {
+          replayTime += i == 0 ? -seekSeconds : seekSeconds;
+        }
+        seekKeysDown[i] = down;
+      }
+      replayTime = std::clamp(replayTime, 0.0, replay->duration());
+    } else if (inlineSimulation) {
+      simulation.advance(Simulation::Clock::now());
+    }
+    frameView = view;
+    frame.run(jobs);
+    if (!tracePath.empty()) {
+      trace.record(frame);
+    }
   });
+  simulation.stop();
+  if (recorder) {
+    recorder->close();
+    std::println("Recorded {} steps in {} bytes to {}",
+                 recorder->stepsWritten(), recorder->bytesWritten(),
+                 recordPath);
+  }
+
+  const GLState &state = GLState::getInstance();
+  if (std::size_t frames = state.getFrameCount(); frames != 0) {
+    const GLState::Statistics &stats = state.getTotalStatistics();
+    std::println("GL binds per frame: {} issued, {} elided; {} draw calls",
+                 stats.totalIssued() / frames, stats.totalElided() / frames,
+                 stats.draws / frames);
+    std::println("Objects per frame: {} drawn, {} culled",
+                 stats.objectsDrawn / frames, stats.objectsCulled / frames);
+    std::println("Critical path of the last frame on {} threads: {}",
+                 jobs.size(), frame.describeCriticalPath());
+    std::println("Simulation steps: {} at {:.0f} Hz ({} dropped), for {} "
+                 "frames",
+                 simulation.stepCount(),
+                 1.0 / std::chrono::duration<double>(simulation.step()).count(),
+                 simulation.droppedSteps(), frames);
+  }
+  if (!tracePath.empty()) {
+    std::ofstream out(tracePath);
+    trace.write(out);
+    std::println("Wrote {} frames of task timings to {}", trace.frameCount(),
+                 tracePath);
+  }
+
+  if (DebugOutput &debug = DebugOutput::getInstance(); debug.isEnabled()) {
+    debug.report(stderr);
+  }
 
   return 0;
 }
@@ -0,0 +1,156 @@
+// Headless benchmark for OcclusionCuller: a field of skull.stl instances
+// behind a few wall occluders, viewed from a camera sweeping around the
+// field. Prints how many skulls survive frustum and occlusion culling and
+// how long each stage takes.
+
+#include <OpenMesh/Core/IO/MeshIO.hh>
+#include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <print>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bounds.hpp"
+#include "frustum.hpp"
+#include "occlusion_culler.hpp"
+
+using MyMesh = OpenMesh::TriMesh_ArrayKernelT<>;
+
+namespace {
+
+struct Occluder {
+  std::array<glm::vec3, 8> positions;
+  std::array<std::uint32_t, 36> indices;
+};
+
+// A unit cube, scaled into walls by its model matrix.
+Occluder unitBox() {
+  Occluder box;
+  for (int corner = 0; corner < 8; ++corner) {
+    box.positions[corner] = {(corner & 1) ? 0.5f : -0.5f,
+                             (corner & 2) ? 0.5f : -0.5f,
+                             (corner & 4) ? 0.5f : -0.5f};
+  }
+  box.indices = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+                 2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+  return box;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string filename = argc > 1 ? argv[1] : "skull.stl";
+  MyMesh mesh;
+  if (!OpenMesh::IO::read_mesh(mesh, filename)) {
+    std::cerr << "Error: Cannot read mesh from " << filename << '\n';
+    return EXIT_FAILURE;
+  }
+  std::vector<float> positions;
+  positions.reserve(mesh.n_vertices() * 3);
+  for (const auto &vertex : mesh.vertices()) {
+    const auto &point = mesh.point(vertex);
+    positions.insert(positions.end(), {point[0], point[1], point[2]});
+  }
+  Bounds skull = Bounds::fromPositions(positions);
+
+  // Scale every skull to about one unit and lay them out on a grid.
+  constexpr int side = 64;
+  constexpr float spacing = 3.0f;
+  glm::vec3 size = skull.box.max - skull.box.min;
+  float scale = 1.0f / std::max({size.x, size.y, size.z, 1e-6f});
+  std::vector<AABB> instances;
+  instances.reserve(side * side);
+  for (int z = 0; z < side; ++z) {
+    for (int x = 0; x < side; ++x) {
+      glm::vec3 position = {(static_cast<float>(x) - side / 2.0f) * spacing,
+                            0.5f,
+                            (static_cast<float>(z) - side / 2.0f) * spacing};
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+      model = glm::scale(model, glm::vec3(scale));
+      model = glm::translate(model, -skull.box.center());
+      instances.push_back(skull.box.transformed(model));
+    }
+  }
+
+  // A ring of walls around the middle of the field.
+  Occluder box = unitBox();
+  std::vector<glm::mat4> walls;
+  constexpr int wallCount = 8;
+  for (int i = 0; i < wallCount; ++i) {
+    float angle = glm::two_pi<float>() * static_cast<float>(i) / wallCount;
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), angle, {0.0f, 1.0f, 0.0f});
+    model = glm::translate(model, {0.0f, 4.0f, 25.0f});
+    walls.push_back(glm::scale(model, {18.0f, 8.0f, 1.0f}));
+  }
+
+  glm::mat4 projection =
+      glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+  OcclusionCuller culler(256, 144);
+  constexpr int frames = 120;
+  std::size_t inFrustum = 0;
+  std::size_t occluded = 0;
+  std::chrono::duration<double, std::milli> rasterTime{};
+  std::chrono::duration<double, std::milli> testTime{};
+  std::vector<std::uint32_t> visible;
+  SphereCuller spheres;
+  for (const AABB &instance : instances) {
+    spheres.add({.center = instance.center(),
+                 .radius = glm::length(instance.extent())});
+  }
+
+  for (int frame = 0; frame < frames; ++frame) {
+    float angle = glm::two_pi<float>() * static_cast<float>(frame) / frames;
+    glm::vec3 eye = {std::sin(angle) * 40.0f, 2.0f, std::cos(angle) * 40.0f};
+    glm::mat4 viewProjection =
+        projection * glm::lookAt(eye, glm::vec3(0.0f), {0.0f, 1.0f, 0.0f});
+
+    auto start = std::chrono::steady_clock::now();
+    culler.beginFrame(viewProjection);
+    for (const glm::mat4 &wall : walls) {
+      culler.addOccluder(box.positions, box.indices, wall);
+    }
+    culler.buildPyramid();
+    auto rasterized = std::chrono::steady_clock::now();
+
+    visible.clear();
+    spheres.cull(Frustum(viewProjection), visible);
+    inFrustum += visible.size();
+    for (std::uint32_t index : visible) {
+      culler.isVisible(instances[index]);
+    }
+    occluded += culler.getStatistics().occluded;
+    auto tested = std::chrono::steady_clock::now();
+
+    rasterTime += rasterized - start;
+    testTime += tested - rasterized;
+  }
+
+  std::size_t total = instances.size() * frames;
+  std::println("{} skulls ({} triangles each), {} wall occluders, {} frames",
+               instances.size(), mesh.n_faces(), walls.size(), frames);
+  std::println("per frame: {} in frustum, {} occluded, {} drawn",
+               inFrustum / frames, occluded / frames,
+               (inFrustum - occluded) / frames);
+  std::println("occlusion rate: {:.1f}% of frustum-visible skulls, "
+               "{:.1f}% of all",
+               inFrustum != 0 ? 100.0 * static_cast<double>(occluded) /
+                                    static_cast<double>(inFrustum)
+                              : 0.0,
+               100.0 * static_cast<double>(occluded) /
+                   static_cast<double>(total));
+  std::println("time per frame: {:.3f} ms rasterise + pyramid, {:.3f} ms "
+               "frustum + occlusion tests",
+               rasterTime.count() / frames, testTime.count() / frames);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+// Runs the line-following car headless for many configurations of its
+// controller at once, to tune it without recompiling, and writes how each
+// one did as CSV or JSON.
+//
+//   robotic_car_sweep [--grid | --random N | --lhs N] [--seed S]
+//                     [--speed RANGE] [--turn RANGE] [--hold RANGE]
+//                     [--spread RANGE] [--reach RANGE]
+//                     [--seconds S] [--dt SECONDS] [--threads T]
+//                     [--image line.jpg] [--csv PATH] [--json PATH]
+//
+// A RANGE is MIN:MAX:LEVELS, MIN:MAX, or a single value that holds the
+// parameter fixed; unnamed parameters keep the car's defaults. --speed is
+// in units per second, --turn in degrees per correction and --hold in
+// seconds; --spread and --reach scale the sensors' offsets across and along
+// the car. --grid (the default) runs every combination of the ranges'
+// LEVELS values; --random draws N configurations uniformly from the ranges
+// and --lhs N as a Latin hypercube, which covers each range evenly.
+//
+// Each configuration runs for S simulated seconds (120 by default) on one
+// of T threads (all hardware threads by default), all of them reading one
+// decoded track and its distance field. The results go to --csv or --json,
+// or as CSV to stdout when neither is given: the parameters, the first lap
+// time, the seconds spent off the track, and the steps simulated per
+// second.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "car_simulation.hpp"
+#include "distance_field.hpp"
+#include "job_system.hpp"
+#include "parameter_sweep.hpp"
+#include "summed_area_table.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+// Parses MIN:MAX:LEVELS, MIN:MAX (two levels) or VALUE.
+ParameterSweep::Axis parseAxis(const std::string &text) {
+  std::size_t first = text.find(':');
+  if (first == std::string::npos) {
+    float value = std::stof(text);
+    return {.min = value, .max = value};
+  }
+  std::size_t second = text.find(':', first + 1);
+  ParameterSweep::Axis axis{
+      .min = std::stof(text.substr(0, first)),
+      .max = std::stof(text.substr(first + 1, second - first - 1)),
+      .levels = 2};
+  if (second != std::string::npos) {
+    axis.levels = std::stoi(text.substr(second + 1));
+  }
+  if (axis.levels < 1) {
+    throw std::runtime_error("A range needs at least one level: " + text);
+  }
+  return axis;
+}
+
+// Writes to `path`, or to stdout when it is "-".
+void writeResults(const std::string &path,
+                  const std::vector<ParameterSweep::Result> &results,
+                  bool json) {
+  auto write = [&](std::ostream &out) {
+    if (json) {
+      ParameterSweep::writeJson(out, results);
+    } else {
+      ParameterSweep::writeCsv(out, results);
+    }
+  };
+  if (path == "-") {
+    write(std::cout);
+    return;
+  }
+  std::ofstream file(path);
+  if (!file) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+  write(file);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  enum class Sampling { grid, random, latinHypercube };
+  Sampling sampling = Sampling::grid;
+  std::size_t samples = 0;
+  std::uint32_t seed = 1;
+  ParameterSweep::Axes axes = ParameterSweep::defaultAxes();
+  ParameterSweep::Settings settings;
+  std::size_t threads = ThreadPool::defaultThreadCount();
+  std::string image = "line.jpg";
+  std::string csvPath;
+  std::string jsonPath;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string_view option = argv[i];
+      if (option == "--grid") {
+        sampling = Sampling::grid;
+        continue;
+      }
+      if (i + 1 == argc) {
+        std::cerr << "Missing value for " << option << '\n';
+        return EXIT_FAILURE;
+      }
+      std::string value = argv[++i];
+      if (option == "--random") {
+        sampling = Sampling::random;
+        samples = std::stoull(value);
+      } else if (option == "--lhs") {
+        sampling = Sampling::latinHypercube;
+        samples = std::stoull(value);
+      } else if (option == "--seed") {
+        seed = static_cast<std::uint32_t>(std::stoul(value));
+      } else if (option == "--speed") {
+        axes[0] = parseAxis(value);
+      } else if (option == "--turn") {
+        axes[1] = parseAxis(value);
+      } else if (option == "--hold") {
+        axes[2] = parseAxis(value);
+      } else if (option == "--spread") {
+        axes[3] = parseAxis(value);
+      } else if (option == "--reach") {
+        axes[4] = parseAxis(value);
+      } else if (option == "--seconds") {
+        settings.seconds = std::stod(value);
+      } else if (option == "--dt") {
+        settings.deltaTime = std::stof(value);
+      } else if (option == "--threads") {
+        threads = std::stoull(value);
+      } else if (option == "--image") {
+        image = value;
+      } else if (option == "--csv") {
+        csvPath = value;
+      } else if (option == "--json") {
+        jsonPath = value;
+      } else {
+        std::cerr << "Unknown option " << option << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    if (csvPath.empty() && jsonPath.empty()) {
+      csvPath = "-";
+    }
+
+    std::vector<ParameterSweep::Point> points;
+    switch (sampling) {
+    case Sampling::grid:
+      points = ParameterSweep::grid(axes);
+      break;
+    case Sampling::random:
+      points = ParameterSweep::random(axes, samples, seed);
+      break;
+    case Sampling::latinHypercube:
+      points = ParameterSweep::latinHypercube(axes, samples, seed);
+      break;
+    }
+
+    // Decoded once and shared read-only by every run.
+    auto track = std::make_shared<const SummedAreaTable>(loadTrack(image));
+    DistanceField field = [&image] {
+      JobSystem jobs;
+      return DistanceField::load(image, &jobs);
+    }();
+
+    ThreadPool pool(threads);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ParameterSweep::Result> results =
+        ParameterSweep::runAll(points, track, field, settings, pool);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    if (!csvPath.empty()) {
+      writeResults(csvPath, results, false);
+    }
+    if (!jsonPath.empty()) {
+      writeResults(jsonPath, results, true);
+    }
+
+    std::uint64_t steps = 0;
+    std::size_t laps = 0;
+    for (const ParameterSweep::Result &result : results) {
+      steps += result.steps;
+      laps += result.lapSeconds ? 1 : 0;
+    }
+    // To stderr, so it stays out of CSV written to stdout.
+    std::cerr << std::format(
+        "{} configurations ({} completed a lap) on {} threads in {:.2f} s: "
+        "{:.2f} million steps per second\n",
+        results.size(), laps, pool.size(), seconds,
+        seconds > 0.0 ? static_cast<double>(steps) / seconds / 1e6 : 0.0);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -3,8 +3,7 @@
 
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
 #include <memory>
 
 #include <OpenMesh/Core/IO/MeshIO.hh>
@@ -14,6 +13,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <embedded_resources.hpp>
+
 typedef OpenMesh::TriMesh_ArrayKernelT<> MyMesh;
 
 constexpr unsigned int SCR_WIDTH = 1280;
@@ -65,11 +66,12 @@ public:
     void setUp(const glm::vec3& up) { up_ = up; }
 };
 
-static unsigned int CompileShader(int type, const std::string& source)
+static unsigned int CompileShader(int type, std::string_view source)
 {
     unsigned int shader = glCreateShader(type);
-    const char* src = source.c_str();
-    glShaderSource(shader, 1, &src, nullptr);
+    const char* src = source.data();
+    const GLint length = static_cast<GLint>(source.size());
+    glShaderSource(shader, 1, &src, &length);
     glCompileShader(shader);
 
     int result;
@@ -92,7 +94,7 @@ static unsigned int CompileShader(int type, const std::string& source)
     return shader;
 }
 
-static unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
+static unsigned int CreateShader(std::string_view vertexShader, std::string_view fragmentShader)
 {
     unsigned int program = glCreateProgram();
     unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
@@ -279,17 +281,7 @@ int main(void)
         return -1;
     }
 
-    std::ifstream vertex_file("vertex.glsl");
-    std::ifstream fragment_file("fragment.glsl");
-    if (!vertex_file || !fragment_file) {
-        std::cerr << "vertex and fragment shader included error\n";
-        return -1;
-    }
-    std::stringstream vertex_stream;
-    std::stringstream fragment_stream;
-    vertex_stream << vertex_file.rdbuf();
-    fragment_stream << fragment_file.rdbuf();
-    unsigned int program = CreateShader(vertex_stream.str(), fragment_stream.str());
+    unsigned int program = CreateShader(resources::load("vertex.glsl"), resources::load("fragment.glsl"));
 
     mesh_loader loader("skull.stl");
 
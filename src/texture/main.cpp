@@ -3,8 +3,7 @@
 
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
 #include <memory>
 
 #include <stb_image.h>
@@ -13,13 +12,16 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <embedded_resources.hpp>
+
 #include "proxy.hpp"
 
-static unsigned int CompileShader(int type, const std::string& source)
+static unsigned int CompileShader(int type, std::string_view source)
 {
     unsigned int shader = glCreateShader(type);
-    const char* src = source.c_str();
-    glShaderSource(shader, 1, &src, nullptr);
+    const char* src = source.data();
+    const GLint length = static_cast<GLint>(source.size());
+    glShaderSource(shader, 1, &src, &length);
     glCompileShader(shader);
 
     int result;
@@ -42,7 +44,7 @@ static unsigned int CompileShader(int type, const std::string& source)
     return shader;
 }
 
-static unsigned int CreateShader(const std::string& verticeshader, const std::string& fragmentShader)
+static unsigned int CreateShader(std::string_view verticeshader, std::string_view fragmentShader)
 {
     unsigned int program = glCreateProgram();
     unsigned int vs = CompileShader(GL_VERTEX_SHADER, verticeshader);
@@ -95,17 +97,7 @@ int main(void)
     std::cout << "GL_MAX_TEXTURE_SIZE: " << maxTexSize << std::endl;
 
     {
-        std::ifstream vertex_file("vertex.glsl");
-        std::ifstream fragment_file("fragment.glsl");
-        if (!vertex_file || !fragment_file) {
-            std::cerr << "vertex and fragment shader included error\n";
-            return -1;
-        }
-        std::stringstream vertex_stream;
-        std::stringstream fragment_stream;
-        vertex_stream << vertex_file.rdbuf();
-        fragment_stream << fragment_file.rdbuf();
-        unsigned int program = CreateShader(vertex_stream.str(), fragment_stream.str());
+        unsigned int program = CreateShader(resources::load("vertex.glsl"), resources::load("fragment.glsl"));
         if (program == 0) {
             std::cerr << "Shader program creation failed\n";
             return -1;